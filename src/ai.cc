@@ -6,11 +6,168 @@
 
 #include "ai.h"
 #include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <string>
 #include "point.h"
 #include "board.h"
+#include "ai_scheduler.h"
+#include "formation_stats.h"
+#include "resources.h"
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// Moves are padded to a multiple of the widest vector.
+const int kNumLanes = 16;
+
+// Weights of squares in "EvaluateBoard()".
+// A piece is weighted by its distance to both headquarters,
+// and a piece in headquarters is counted on both of its squares.
+struct SquareWeights {
+  SquareWeights() {
+    Point p;
+    for (p.y = 0; p.y < Board::kHeight; ++p.y) {
+      for (p.x = 0; p.x < Board::kWidth; ++p.x) {
+        int weight = 0;
+        for (int i = 0; i < Board::kNumPlayers; ++i) {
+          weight += (Board::kHeight + Board::kWidth) -
+            Board::MeasureDistanceToHeadquartersOf(i, p);
+        }
+        values[p.y][p.x] = static_cast<int16_t>(weight);
+      }
+    }
+    for (int i = 0; i < Board::kNumPlayers; ++i) {
+      const Point &kLeft = Board::kHeadquarters[i][0];
+      const Point &kRight = Board::kHeadquarters[i][1];
+      int16_t weight = values[kLeft.y][kLeft.x] + values[kRight.y][kRight.x];
+      values[kLeft.y][kLeft.x] = weight;
+      values[kRight.y][kRight.x] = weight;
+    }
+  }
+
+  int16_t values[Board::kHeight][Board::kWidth];
+};
+
+const SquareWeights &square_weights() {
+  static const SquareWeights square_weights;
+  return square_weights;
+}
+
+// Calculates "a * b + c * d + e" for each lane.
+// "n" must be a multiple of "kNumLanes".
+void MultiplyAdd(const int16_t *a, const int16_t *b, const int16_t *c,
+                 const int16_t *d, const int16_t *e, int16_t *result,
+                 int n) {
+#if defined(__AVX2__)
+  for (int i = 0; i < n; i += 16) {
+    __m256i ab = _mm256_mullo_epi16(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i)),
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i)));
+    __m256i cd = _mm256_mullo_epi16(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(c + i)),
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(d + i)));
+    __m256i sum = _mm256_add_epi16(
+        _mm256_add_epi16(ab, cd),
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(e + i)));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(result + i), sum);
+  }
+#elif defined(__SSE2__)
+  for (int i = 0; i < n; i += 8) {
+    __m128i ab = _mm_mullo_epi16(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i)),
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i)));
+    __m128i cd = _mm_mullo_epi16(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(c + i)),
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(d + i)));
+    __m128i sum = _mm_add_epi16(
+        _mm_add_epi16(ab, cd),
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(e + i)));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(result + i), sum);
+  }
+#else
+  for (int i = 0; i < n; ++i)
+    result[i] = static_cast<int16_t>(a[i] * b[i] + c[i] * d[i] + e[i]);
+#endif
+}
+
+// Scores to order moves. History is below killer moves.
+const int kHashMoveScore = 1 << 30;
+const int kBattleScore = 1 << 28;
+const int kKillerScore = 1 << 26;
+
+// Indexed by "Ai::Level". Nodes, milliseconds and depth.
+const Ai::SearchLimits kLevelLimits[Ai::kNumLevels] = {
+  {300, 50, 1},
+  {3000, 200, 2},
+  {30000, 1000, 3},
+  {300000, 3000, 6},
+};
+const char *const kLevelNames[Ai::kNumLevels] = {
+  "beginner", "easy", "normal", "hard",
+};
+
+// Distinguishes the side to move in the hash of the board.
+const uint64_t kSideHashKey = 0x9e3779b97f4a7c15ULL;
+
+bool IsSameMove(const Move &a, const Move &b) {
+  return (a.src.Equals(b.src) && a.dest.Equals(b.dest));
+}
+
+int SquareOf(const Point &p) { return p.y * Board::kWidth + p.x; }
+
+// Kinds as bits of "1 << kind".
+const uint32_t kAllKinds = (1U << Board::Piece::kNumKindPieces) - 1;
+
+// Returns the kind if "kinds" has only one, or "kNone".
+Board::Piece::KindPiece KindOf(uint32_t kinds) {
+  if (kinds == 0 || (kinds & (kinds - 1)) != 0)
+    return Board::Piece::kNone;
+  int kind = 0;
+  while (kinds >>= 1)
+    ++kind;
+  return static_cast<Board::Piece::KindPiece>(kind);
+}
+
+}  // namespace
+
+struct Ai::SearchTables {
+  static const int kNumHashMoves = 1 << 12;
+  static const int kNumEvaluations = 1 << 14;
+  static const int kNumSquares = Board::kHeight * Board::kWidth;
+
+  struct HashMove {
+    uint64_t key;
+    Move move;
+  };
+  // Of the search of "generation" only, because the value depends on
+  // the ai and its weights.
+  struct Evaluation {
+    uint64_t key;
+    int value;
+    uint32_t generation;
+  };
+
+  HashMove hash_moves[kNumHashMoves];
+  Move killers[kMaxDepth][2];
+  // Indexed by the feature of the moved piece, source and destination.
+  int history[kFeatureUnknown + 1][kNumSquares][kNumSquares];
+  Evaluation evaluations[kNumEvaluations];
+  uint32_t generation;
+};
 
 const int Ai::kMaxTimesSwapPiecesRandomly = 2;
-const char *Ai::kFormationFileUrl = "src/resources/formations.txt";
+const char *Ai::kFormationFileName = "formations.txt";
+const char *Ai::kWeightFileName = "weights.txt";
 
 void Ai::ReplacePieces() {
   LoadFormationRandomly();
@@ -18,91 +175,801 @@ void Ai::ReplacePieces() {
 }
 
 Move Ai::MovePiece() {
-  if (board()->prev_move_is_initialized()) {
-    Board::Piece attacked_piece = board()->prev_dest_piece();
-    SupposeOpponentsFormation(attacked_piece);
+  return MovePiece(search_limits_);
+}
+
+Move Ai::MovePiece(const SearchLimits &limits) {
+  if (board()->prev_move_is_initialized())
+    Observe();
+  if (!stats_are_supposed_) {
+    stats_are_supposed_ = true;
+    SupposeFormationFromStats();
+  }
+
+  // Determine a move.
+  Move best_move = Search(limits, &search_info_);
+  board()->Battle(best_move);
+  Observe();
+
+  return best_move;
+}
+
+Character::TurnStatus Ai::ResumeMovePiece(Move *move) {
+  if (!scheduler_) {
+    *move = MovePiece();
+    return kDone;
+  }
+
+  // Request the scheduler to move a piece.
+  if (!is_requested_) {
+    is_requested_ = true;
+    is_moved_ = false;
+    scheduler_->Request(this, deadline_milliseconds_,
+                        [this](const AiScheduler::Result &result) {
+      scheduled_move_ = result.move;
+      queueing_microseconds_ = result.queueing_microseconds;
+      computing_microseconds_ = result.computing_microseconds;
+      is_moved_ = true;
+      if (moved_)
+        moved_();
+    });
+    return kWaiting;
+  }
+
+  // Wait for the scheduler.
+  if (!is_moved_)
+    return kWaiting;
+  is_requested_ = false;
+  *move = scheduled_move_;
+  return kDone;
+}
+
+void Ai::Observe() {
+  DeduceOpponentsKinds();
+
+  // Suppose with the piece of the ai which battled.
+  if (board()->prev_src_piece().characters_id == id())
+    SupposeOpponentsFormation(board()->prev_src_piece());
+  else
+    SupposeOpponentsFormation(board()->prev_dest_piece());
+}
+
+Move Ai::Search(const SearchLimits &limits, SearchInfo *info) {
+  StartSearch(limits, info);
+
+  // Switch to the endgame solver once it proves the result. A lost one
+  // is searched still for mistakes of the opponent. The search is left
+  // half of the time at least if the solver gives up.
+  EndgameSolver::Result endgame;
+  int solvers_milliseconds = (limits.max_milliseconds == 0) ? 0 :
+    std::max(1, limits.max_milliseconds / 2);
+  if (SolveEndgame(solvers_milliseconds, &endgame)) {
+    info->endgame_value = endgame.value;
+    if (endgame.value != EndgameSolver::kLoss &&
+        board()->IsMoveValid(endgame.move)) {
+      info->num_nodes = EndgameSolver::num_nodes();
+      info->milliseconds = CountMilliseconds();
+      info->evaluation_value = (endgame.value == EndgameSolver::kWin) ?
+        kSolvedValue - endgame.distance : 0;
+      info_ = nullptr;
+      return endgame.move;
+    }
   }
 
-  // Determine a source.
+  OrderRootMoves(limits);
+
+  // Deepen the search while the limits allow.
+  int max_depth = (limits.max_depth == 0) ? kDefaultDepth : limits.max_depth;
+  if (kMaxDepth < max_depth)
+    max_depth = kMaxDepth;
   int best_evaluation_value = INT_MIN;
-  Move move, best_move;
-  for (move.src.y = 0; move.src.y < Board::kHeight; ++move.src.y) {
-    for (move.src.x = 0; move.src.x < Board::kWidth; ++move.src.x) {
-      Board::Piece current_src = board()->board(move.src);
-      // If a current piece is unavailable as source.
-      if (current_src.characters_id != id() ||
-          board()->CountNumPlaceableSquares(move.src) <= 0) {
-        continue;
+  Move best_move = {};
+  for (int depth = 1; depth <= max_depth && !order_.empty(); ++depth) {
+    int alpha = -INT_MAX;
+    int best_id = 0;
+    bool is_finished = true;
+    for (int i = 0; i < static_cast<int>(order_.size()); ++i) {
+      // The first iteration uses moves searched so far, but the others
+      // are not comparable to the previous iteration till they finish.
+      if ((0 < i || 1 < depth) && IsSearchEnd()) {
+        is_finished = false;
+        break;
+      }
+
+      board()->SupposeBattle(id(), moves_[order_[i]]);
+      int evaluation_value =
+        -AlphaBeta(depth - 1, -INT_MAX, -alpha, opponents_id(), 1);
+      board()->Undo();
+      if (1 < depth && IsSearchEnd()) {
+        is_finished = false;
+        break;
       }
+      if (alpha < evaluation_value) {
+        alpha = evaluation_value;
+        best_id = i;
+      }
+    }
+    if (depth == 1 || is_finished) {
+      best_move = moves_[order_[best_id]];
+      best_evaluation_value = alpha;
+      info->depth = depth;
+      // Search the best move first in the next iteration.
+      std::rotate(order_.begin(), order_.begin() + best_id,
+                  order_.begin() + best_id + 1);
+    }
+    if (!is_finished)
+      break;
+  }
 
-      // Determine a destination.
-      for (move.dest.y = 0; move.dest.y < Board::kHeight; ++move.dest.y) {
-        for (move.dest.x = 0; move.dest.x < Board::kWidth; ++move.dest.x) {
-          // If a current piece is unavailable as dest.
-          if (!board()->IsMoveValid(move))
-            continue;
+  info->milliseconds = CountMilliseconds();
+  info->evaluation_value = best_evaluation_value;
+  info_ = nullptr;
+  tables_ = nullptr;
+  return best_move;
+}
 
-          board()->SupposeBattle(id(), move);
-          int evaluation_value = EvaluateBoard();
-          board()->Undo();
+void Ai::Analyze(const SearchLimits &limits, int num_lines,
+                 const std::function<void(const Analysis &)> &report) {
+  SearchInfo info;
+  StartSearch(limits, &info);
+  OrderRootMoves(limits);
 
-          // Update the best move.
-          if (best_evaluation_value < evaluation_value) {
-            best_move = move;
-            best_evaluation_value = evaluation_value;
+  int max_depth = (limits.max_depth == 0) ? kMaxDepth : limits.max_depth;
+  if (kMaxDepth < max_depth)
+    max_depth = kMaxDepth;
+  std::vector<int> evaluation_values(moves_.size());
+  std::vector<int> best_values;
+  Analysis analysis;
+  for (int depth = 1; depth <= max_depth && !order_.empty(); ++depth) {
+    // Moves below the "num_lines"-th best are searched only to know that.
+    best_values.clear();
+    bool is_finished = true;
+    for (int i = 0; i < static_cast<int>(order_.size()); ++i) {
+      if (IsSearchEnd()) {
+        is_finished = false;
+        break;
+      }
+
+      int alpha = (static_cast<int>(best_values.size()) < num_lines) ?
+        -INT_MAX : best_values.back();
+      board()->SupposeBattle(id(), moves_[order_[i]]);
+      int evaluation_value =
+        -AlphaBeta(depth - 1, -INT_MAX, -alpha, opponents_id(), 1);
+      board()->Undo();
+      if (IsSearchEnd()) {
+        is_finished = false;
+        break;
+      }
+      evaluation_values[order_[i]] = evaluation_value;
+      best_values.insert(
+          std::upper_bound(best_values.begin(), best_values.end(),
+                           evaluation_value, std::greater<int>()),
+          evaluation_value);
+      if (num_lines < static_cast<int>(best_values.size()))
+        best_values.pop_back();
+    }
+    if (!is_finished)
+      break;
+
+    // The best moves are searched first in the next iteration.
+    std::stable_sort(order_.begin(), order_.end(),
+                     [&evaluation_values](int a, int b) {
+      return evaluation_values[a] > evaluation_values[b];
+    });
+    analysis.depth = depth;
+    analysis.num_nodes = info.num_nodes;
+    analysis.milliseconds = CountMilliseconds();
+    analysis.lines.resize(best_values.size());
+    for (int i = 0; i < static_cast<int>(analysis.lines.size()); ++i) {
+      Line &line = analysis.lines[i];
+      line.move = moves_[order_[i]];
+      line.evaluation_value = evaluation_values[order_[i]];
+      ExtractPrincipalVariation(line.move, depth, &line.principal_variation);
+    }
+    report(analysis);
+  }
+
+  info_ = nullptr;
+  tables_ = nullptr;
+}
+
+void Ai::StartSearch(const SearchLimits &limits, SearchInfo *info) {
+  // Pieces of the opponent move as the ai supposes in the search.
+  board()->set_supposer_id(id());
+  start_ = std::chrono::steady_clock::now();
+  limits_ = limits;
+  info_ = info;
+  info->num_nodes = 0;
+  info->depth = 0;
+  info->num_cutoffs = 0;
+  info->num_first_move_cutoffs = 0;
+  info->num_quiescence_nodes = 0;
+  info->max_quiescence_depth = 0;
+  info->num_stand_pats = 0;
+  info->num_delta_prunes = 0;
+  info->num_evaluations = 0;
+  info->num_evaluation_hits = 0;
+  info->endgame_value = EndgameSolver::kUnknown;
+}
+
+int Ai::CountMilliseconds() const {
+  return static_cast<int>(
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now() - start_).count());
+}
+
+void Ai::OrderRootMoves(const SearchLimits &limits) {
+  // Tables are shared by searches on the same thread not to keep them
+  // for each ai, and they are cleared for each search. Evaluations are
+  // cleared by the generation instead, because they are the largest.
+  static thread_local std::unique_ptr<SearchTables> tables;
+  if (!tables)
+    tables.reset(new SearchTables());
+  memset(tables->hash_moves, 0, sizeof(tables->hash_moves));
+  memset(tables->killers, 0, sizeof(tables->killers));
+  memset(tables->history, 0, sizeof(tables->history));
+  if (++tables->generation == 0) {
+    memset(tables->evaluations, 0, sizeof(tables->evaluations));
+    tables->generation = 1;
+  }
+  tables_ = tables.get();
+
+  // Evaluate all candidates at once within the node limit.
+  // The batch is too short to check the time on the way.
+  moves_.clear();
+  board()->GenerateMoves(id(), &moves_);
+  if (limits.max_num_nodes != 0 &&
+      limits.max_num_nodes < static_cast<int>(moves_.size())) {
+    moves_.resize(limits.max_num_nodes);
+  }
+  EvaluateMoves(moves_, &values_);
+  info_->num_nodes = static_cast<int>(moves_.size());
+
+  // The first iteration searches in order of the static values.
+  // The first one wins a tie.
+  order_.resize(moves_.size());
+  for (int i = 0; i < static_cast<int>(order_.size()); ++i)
+    order_[i] = i;
+  std::stable_sort(order_.begin(), order_.end(), [this](int a, int b) {
+    return values_[a] > values_[b];
+  });
+}
+
+void Ai::ExtractPrincipalVariation(const Move &move, int depth,
+                                   std::vector<Move> *moves) {
+  moves->clear();
+  moves->push_back(move);
+  board()->SupposeBattle(id(), move);
+
+  // A hash move may be overwritten by another position.
+  int characters_id = opponents_id();
+  int winners_id = 0;
+  bool game_was_drawn = false;
+  while (static_cast<int>(moves->size()) < depth &&
+         !board()->IsEnd(&winners_id, &game_was_drawn)) {
+    uint64_t key = HashKeyOf(characters_id);
+    const SearchTables::HashMove &kHashMove =
+      tables_->hash_moves[key & (SearchTables::kNumHashMoves - 1)];
+    if (kHashMove.key != key ||
+        !board()->IsSupposedMoveValid(kHashMove.move) ||
+        board()->board(kHashMove.move.src).characters_id != characters_id) {
+      break;
+    }
+    moves->push_back(kHashMove.move);
+    board()->SupposeBattle(id(), kHashMove.move);
+    characters_id = 1 - characters_id;
+  }
+
+  for (int i = 0; i < static_cast<int>(moves->size()); ++i)
+    board()->Undo();
+}
+
+int Ai::AlphaBeta(int depth, int alpha, int beta, int characters_id,
+                  int ply) {
+  if (depth <= 0)
+    return Quiesce(alpha, beta, characters_id, 1);
+  ++info_->num_nodes;
+  if (IsSearchEnd())
+    return (characters_id == id()) ? EvaluateCachedBoard() :
+      -EvaluateCachedBoard();
+
+  std::vector<Move> &moves = moves_by_ply_[ply];
+  std::vector<int> &scores = scores_by_ply_[ply];
+  moves.clear();
+  board()->GenerateMoves(characters_id, &moves);
+  if (moves.empty())
+    return (characters_id == id()) ? EvaluateCachedBoard() :
+      -EvaluateCachedBoard();
+  ScoreMoves(characters_id, ply, moves, &scores);
+
+  int best_evaluation_value = -INT_MAX;
+  Move best_move = moves[0];
+  for (int i = 0; i < static_cast<int>(moves.size()); ++i) {
+    // Take the best move left.
+    int best_id = static_cast<int>(
+        std::max_element(scores.begin() + i, scores.end()) - scores.begin());
+    std::swap(moves[i], moves[best_id]);
+    std::swap(scores[i], scores[best_id]);
+
+    bool is_battle = board()->board(moves[i].dest).IsPiece();
+    board()->SupposeBattle(id(), moves[i]);
+    int evaluation_value =
+      -AlphaBeta(depth - 1, -beta, -alpha, 1 - characters_id, ply + 1);
+    board()->Undo();
+    if (best_evaluation_value < evaluation_value) {
+      best_evaluation_value = evaluation_value;
+      best_move = moves[i];
+    }
+    alpha = std::max(alpha, evaluation_value);
+    if (beta <= alpha) {
+      ++info_->num_cutoffs;
+      if (i == 0)
+        ++info_->num_first_move_cutoffs;
+      if (!is_battle)
+        RecordCutoff(moves[i], depth, ply);
+      break;
+    }
+  }
+
+  // Remember the best move to search it first next time.
+  uint64_t key = HashKeyOf(characters_id);
+  SearchTables::HashMove &hash_move =
+    tables_->hash_moves[key & (SearchTables::kNumHashMoves - 1)];
+  hash_move.key = key;
+  hash_move.move = best_move;
+  return best_evaluation_value;
+}
+
+void Ai::ScoreMoves(int characters_id, int ply,
+                    const std::vector<Move> &moves,
+                    std::vector<int> *scores) const {
+  // Battles are ranked by the results expected by the ai first,
+  // and then by the strength of the pieces taken.
+  static const int kResultRanks[] = {0, 2, 1};  // kL, kW, kD.
+  uint64_t key = HashKeyOf(characters_id);
+  const SearchTables::HashMove &kHashMove =
+    tables_->hash_moves[key & (SearchTables::kNumHashMoves - 1)];
+  const Move *kKillers = tables_->killers[ply];
+  scores->resize(moves.size());
+  for (int i = 0; i < static_cast<int>(moves.size()); ++i) {
+    const Move &kMove = moves[i];
+    Board::Piece src = board()->board(kMove.src);
+    Board::Piece dest = board()->board(kMove.dest);
+    int &score = (*scores)[i];
+    if (kHashMove.key == key && IsSameMove(kMove, kHashMove.move)) {
+      score = kHashMoveScore;
+    } else if (dest.IsPiece()) {
+      Board::BattleResult result = board()->SupposeBattleResult(id(), kMove);
+      score = kBattleScore +
+        kResultRanks[result] * Board::Piece::kNumKindPieces +
+        Board::Piece::kNumKindPieces - GuessKindOf(dest);
+    } else if (IsSameMove(kMove, kKillers[0])) {
+      score = kKillerScore + 1;
+    } else if (IsSameMove(kMove, kKillers[1])) {
+      score = kKillerScore;
+    } else {
+      score = tables_->history[FeatureOf(src)][SquareOf(kMove.src)]
+                              [SquareOf(kMove.dest)];
+    }
+  }
+}
+
+void Ai::RecordCutoff(const Move &move, int depth, int ply) {
+  Move *killers = tables_->killers[ply];
+  if (!IsSameMove(move, killers[0])) {
+    killers[1] = killers[0];
+    killers[0] = move;
+  }
+
+  // Deeper cutoffs prune more.
+  int &history = tables_->history[FeatureOf(board()->board(move.src))]
+                                 [SquareOf(move.src)][SquareOf(move.dest)];
+  history = std::min(history + depth * depth, kKillerScore - 1);
+}
+
+uint64_t Ai::HashKeyOf(int characters_id) const {
+  return board()->hash() ^ ((characters_id == 0) ? 0 : kSideHashKey);
+}
+
+int Ai::Quiesce(int alpha, int beta, int characters_id, int depth) {
+  ++info_->num_nodes;
+  ++info_->num_quiescence_nodes;
+  info_->max_quiescence_depth = std::max(info_->max_quiescence_depth, depth);
+
+  // The side to move may stop battling.
+  const int kStandPat =
+    (characters_id == id()) ? EvaluateCachedBoard() : -EvaluateCachedBoard();
+  if (beta <= kStandPat) {
+    ++info_->num_stand_pats;
+    return kStandPat;
+  }
+  alpha = std::max(alpha, kStandPat);
+  if (kMaxQuiescenceDepth <= depth || IsSearchEnd())
+    return alpha;
+
+  std::vector<Move> &captures = captures_[depth];
+  captures.clear();
+  GenerateCaptures(characters_id, &captures);
+  for (int i = 0; i < static_cast<int>(captures.size()); ++i) {
+    // Skip a battle which can't raise alpha even if it is won.
+    if (kStandPat + EstimateMaxGain(captures[i]) <= alpha) {
+      ++info_->num_delta_prunes;
+      continue;
+    }
+
+    board()->SupposeBattle(id(), captures[i]);
+    int evaluation_value =
+      -Quiesce(-beta, -alpha, 1 - characters_id, depth + 1);
+    board()->Undo();
+    if (beta <= evaluation_value)
+      return evaluation_value;
+    alpha = std::max(alpha, evaluation_value);
+  }
+  return alpha;
+}
+
+void Ai::GenerateCaptures(int characters_id, std::vector<Move> *moves) const {
+  Point p;
+  for (p.y = 0; p.y < Board::kHeight; ++p.y) {
+    for (p.x = 0; p.x < Board::kWidth; ++p.x) {
+      Board::Piece piece = board()->board(p);
+      if (!piece.IsPiece() || piece.characters_id == characters_id ||
+          board()->IsDummyHeadquarters(p)) {
+        continue;
+      }
+
+      // Find squares of headquarters from and to which the move is valid.
+      uint64_t attackers = board()->attackers(characters_id, p);
+      for (; attackers != 0; attackers &= attackers - 1) {
+        Move move;
+        move.src = Board::PointOf(__builtin_ctzll(attackers));
+        int num_srcs = board()->ExistHeadquartersAt(move.src) ? 2 : 1;
+        int num_dests = board()->ExistHeadquartersAt(p) ? 2 : 1;
+        bool is_found = false;
+        for (int i = 0; i < num_srcs * num_dests && !is_found; ++i) {
+          Move candidate = {{move.src.y, move.src.x + i / num_dests},
+                            {p.y, p.x + i % num_dests}};
+          if (board()->IsSupposedMoveValid(candidate)) {
+            moves->push_back(candidate);
+            is_found = true;
           }
         }
       }
     }
   }
+}
 
-  // Determine a move.
-  board()->Battle(best_move);
-  Board::Piece attacking_piece = board()->prev_src_piece();
-  SupposeOpponentsFormation(attacking_piece);
+int Ai::EstimateMaxGain(const Move &move) const {
+  // The taken piece and the moved piece change.
+  // Tactics rarely change by more than a few pieces.
+  const SquareWeights &kSquareWeights = square_weights();
+  Board::Piece src = board()->board(move.src);
+  Board::Piece dest = board()->board(move.dest);
+  int src_weight = kSquareWeights.values[move.src.y][move.src.x];
+  int dest_weight = kSquareWeights.values[move.dest.y][move.dest.x];
+  return abs(weights_[FeatureOf(dest)]) * dest_weight +
+    abs(weights_[FeatureOf(src)]) * abs(dest_weight - src_weight) +
+    abs(weights_[kFeatureMaterial]) +
+    2 * (abs(weights_[kFeatureHanging]) + abs(weights_[kFeatureThreat]));
+}
+
+bool Ai::SolveEndgame(int max_milliseconds,
+                      EndgameSolver::Result *result) const {
+  if (EndgameSolver::kMaxNumPieces <
+      board()->CountNumPieces(0) + board()->CountNumPieces(1)) {
+    return false;
+  }
 
-  return move;
+  // Solve the board seen from the ai. Suppositions are guesses, so only
+  // deduced kinds prove anything.
+  if (num_deduced_logs_ != board()->num_logs())
+    return false;
+  Board::Squares squares;
+  memcpy(squares, board()->squares(), sizeof(squares));
+  Point p;
+  for (p.y = 0; p.y < Board::kHeight; ++p.y) {
+    for (p.x = 0; p.x < Board::kWidth; ++p.x) {
+      Board::Piece &square = squares[p.y][p.x];
+      if (!square.IsPiece() || square.characters_id == id())
+        continue;
+      Board::Piece::KindPiece kind = KindOf(candidates_[p.y][p.x]);
+      if (kind == Board::Piece::kNone)
+        return false;
+      square.piece = kind;
+    }
+  }
+  std::unique_ptr<Board> view(new Board);
+  view->Load(squares);
+  return EndgameSolver::Solve(*view, id(), max_milliseconds, result,
+                              &is_stopped_);
+}
+
+bool Ai::IsSearchEnd() const {
+  // Microseconds keep the time limit from being overrun by truncation.
+  long long microseconds =
+    std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start_).count();
+  return (is_stopped_ ||
+          (limits_.max_num_nodes != 0 &&
+           limits_.max_num_nodes <= info_->num_nodes) ||
+          (limits_.max_milliseconds != 0 &&
+           limits_.max_milliseconds * 1000LL <= microseconds));
+}
+
+void Ai::EvaluateMoves(const std::vector<Move> &moves,
+                       std::vector<int> *values) {
+  const SquareWeights &kSquareWeights = square_weights();
+  const std::vector<int> &kWeights = weights();
+  const int kNumMoves = static_cast<int>(moves.size());
+  const int kNumPaddedMoves =
+    (kNumMoves + kNumLanes - 1) / kNumLanes * kNumLanes;
+
+  // Extract features of the squares changed by each move.
+  MoveFeatures &features = features_;
+  features.src_strength.assign(kNumPaddedMoves, 0);
+  features.src_weight.assign(kNumPaddedMoves, 0);
+  features.dest_strength.assign(kNumPaddedMoves, 0);
+  features.dest_weight.assign(kNumPaddedMoves, 0);
+  features.bonus.assign(kNumPaddedMoves, 0);
+  features.difference.resize(kNumPaddedMoves);
+  for (int i = 0; i < kNumMoves; ++i) {
+    const Move &kMove = moves[i];
+    Board::Piece src = board()->board(kMove.src);
+    Board::Piece dest = board()->board(kMove.dest);
+    int src_weight = kSquareWeights.values[kMove.src.y][kMove.src.x];
+    int dest_weight = kSquareWeights.values[kMove.dest.y][kMove.dest.x];
+
+    Board::BattleResult result = board()->SupposeBattleResult(id(), kMove);
+
+    // The source leaves and the winner stays on the destination.
+    features.src_strength[i] =
+      static_cast<int16_t>(kWeights[FeatureOf(src)]);
+    features.src_weight[i] = static_cast<int16_t>(
+        ((result == Board::kW) ? dest_weight : 0) - src_weight);
+    if (dest.IsPiece()) {
+      features.dest_strength[i] = static_cast<int16_t>(
+          (dest.characters_id == id()) ? kWeights[FeatureOf(dest)] :
+          -kWeights[FeatureOf(dest)]);
+      features.dest_weight[i] = static_cast<int16_t>(
+          (result == Board::kL) ? 0 : -dest_weight);
+    }
+    // A draw loses a piece of both.
+    if (result == Board::kW && dest.IsPiece())
+      features.bonus[i] = static_cast<int16_t>(kWeights[kFeatureMaterial]);
+    else if (result == Board::kL)
+      features.bonus[i] = static_cast<int16_t>(-kWeights[kFeatureMaterial]);
+  }
+
+  // Differences from the current board are small enough for 16 bits.
+  MultiplyAdd(&features.src_strength[0], &features.src_weight[0],
+              &features.dest_strength[0], &features.dest_weight[0],
+              &features.bonus[0], &features.difference[0], kNumPaddedMoves);
+  int board_features[kNumFeatures];
+  ExtractFeatures(board_features);
+  int evaluation_value = 0;
+  for (int i = 0; i < kFeatureHanging; ++i)
+    evaluation_value += kWeights[i] * board_features[i];
+  values->resize(kNumMoves);
+  for (int i = 0; i < kNumMoves; ++i)
+    (*values)[i] = evaluation_value + features.difference[i];
+
+  // Tactical features change all over the board, since a move blocks and
+  // unblocks pieces passing its squares. They are extracted after making
+  // each move with the attack maps instead of in the batch, which is slow
+  // beside it but done once for each search.
+  if (kWeights[kFeatureHanging] == 0 && kWeights[kFeatureThreat] == 0)
+    return;
+  for (int i = 0; i < kNumMoves; ++i) {
+    board()->SupposeBattle(id(), moves[i]);
+    ExtractTacticalFeatures(board_features);
+    board()->Undo();
+    (*values)[i] +=
+      kWeights[kFeatureHanging] * board_features[kFeatureHanging] +
+      kWeights[kFeatureThreat] * board_features[kFeatureThreat];
+  }
+}
+
+int Ai::EvaluateCachedBoard() {
+  // The evaluation does not depend on the side to move.
+  ++info_->num_evaluations;
+  uint64_t key = board()->hash() ^ board()->supposition_hash();
+  SearchTables::Evaluation &evaluation =
+    tables_->evaluations[key & (SearchTables::kNumEvaluations - 1)];
+  if (evaluation.generation == tables_->generation && evaluation.key == key) {
+    ++info_->num_evaluation_hits;
+    return evaluation.value;
+  }
+
+  evaluation.key = key;
+  evaluation.value = EvaluateBoard();
+  evaluation.generation = tables_->generation;
+  return evaluation.value;
 }
 
 int Ai::EvaluateBoard() const {
-  // Calculate offensive power and defensive power.
-  int attack[Board::kNumPlayers] = {0};
-  int defense[Board::kNumPlayers] = {0};
-  for (int i = 0; i < Board::kNumPlayers; ++i) {
-    Point p;
-    for (p.y = 0; p.y < Board::kHeight; ++p.y) {
-      for (p.x = 0; p.x < Board::kWidth; ++p.x) {
-        // Get the current piece.
-        Board::Piece piece = board()->board(p);
-        if (!piece.IsPiece())
-          continue;
+  int features[kNumFeatures];
+  ExtractFeatures(features);
+  const std::vector<int> &kWeights = weights();
+  int evaluation_value = 0;
+  for (int i = 0; i < kNumFeatures; ++i)
+    evaluation_value += kWeights[i] * features[i];
 
-        // Evaluate the board with distance to each headquarters
-        // and its strength.
-        Board::Piece::KindPiece strength =
-          static_cast<Board::Piece::KindPiece>(
-          Board::Piece::kNumKindPieces - ((i == Ai::id()) ? piece.piece :
-          (piece.supposition != Board::Piece::kNone) ? piece.supposition :
-          Board::Piece::kChusa));
-        int distance_to_headquarters = (Board::kHeight + Board::kWidth) -
-          board()->MeasureDistanceToHeadquartersOf(i, p);
-        if (piece.characters_id == i)
-          defense[i] += distance_to_headquarters * strength;
-        else
-          attack[1 - i] += distance_to_headquarters * strength;
-      }
+  return evaluation_value;
+}
+
+void Ai::ExtractFeatures(int features[kNumFeatures]) const {
+  // Sum the offensive power and the defensive power of each kind,
+  // which are its distance to each headquarters.
+  const SquareWeights &kSquareWeights = square_weights();
+  std::fill(features, features + kNumFeatures, 0);
+  Point p;
+  for (p.y = 0; p.y < Board::kHeight; ++p.y) {
+    for (p.x = 0; p.x < Board::kWidth; ++p.x) {
+      // Headquarters is weighted on the real square.
+      Board::Piece piece = board()->board(p);
+      if (!piece.IsPiece() || board()->IsDummyHeadquarters(p))
+        continue;
+
+      int weight = kSquareWeights.values[p.y][p.x];
+      features[FeatureOf(piece)] +=
+        (piece.characters_id == id()) ? weight : -weight;
     }
   }
 
-  int score = board()->CountNumPieces(id()) -
+  features[kFeatureMaterial] = board()->CountNumPieces(id()) -
     board()->CountNumPieces(opponents_id());
-  int evaluation_value_ai = attack[id()] + defense[id()];
-  int evaluation_value_opponent =
-    attack[opponents_id()] + defense[opponents_id()];
-  int evaluation_value = evaluation_value_ai - evaluation_value_opponent +
-    score * 10;
+  ExtractTacticalFeatures(features);
+}
 
-  return evaluation_value;
+void Ai::ExtractTacticalFeatures(int features[kNumFeatures]) const {
+  // Count pieces which lose to one of the pieces reaching them.
+  int num_hanging_pieces[Board::kNumPlayers] = {0};
+  Point p;
+  for (p.y = 0; p.y < Board::kHeight; ++p.y) {
+    for (p.x = 0; p.x < Board::kWidth; ++p.x) {
+      Board::Piece piece = board()->board(p);
+      if (!piece.IsPiece() || board()->IsDummyHeadquarters(p))
+        continue;
+      Board::Piece::KindPiece kind_piece = GuessKindOf(piece);
+      if (kind_piece == Board::Piece::kFlag)
+        continue;
+
+      uint64_t attackers = board()->attackers(1 - piece.characters_id, p);
+      for (; attackers != 0; attackers &= attackers - 1) {
+        Board::Piece attacker =
+          board()->board(Board::PointOf(__builtin_ctzll(attackers)));
+        if (Board::kBattleTable[GuessKindOf(attacker)][kind_piece] ==
+            Board::kW) {
+          ++num_hanging_pieces[piece.characters_id];
+          break;
+        }
+      }
+    }
+  }
+
+  // Count pieces which can enter the headquarters of the other.
+  int num_threats[Board::kNumPlayers] = {0};
+  for (int i = 0; i < Board::kNumPlayers; ++i) {
+    uint64_t attackers =
+      board()->attackers(1 - i, Board::kHeadquarters[i][0]);
+    for (; attackers != 0; attackers &= attackers - 1) {
+      Board::Piece attacker =
+        board()->board(Board::PointOf(__builtin_ctzll(attackers)));
+      attacker.piece = GuessKindOf(attacker);
+      if (attacker.IsShokan() || attacker.IsSakan())
+        ++num_threats[i];
+    }
+  }
+
+  features[kFeatureHanging] =
+    num_hanging_pieces[opponents_id()] - num_hanging_pieces[id()];
+  features[kFeatureThreat] = num_threats[opponents_id()] - num_threats[id()];
+}
+
+Board::Piece::KindPiece Ai::GuessKindOf(const Board::Piece &piece) const {
+  return (piece.characters_id == id()) ? piece.piece :
+    (piece.supposition != Board::Piece::kNone) ? piece.supposition :
+    Board::Piece::kChusa;
+}
+
+int Ai::FeatureOf(const Board::Piece &piece) const {
+  return (piece.characters_id == id()) ? piece.piece :
+    (piece.supposition != Board::Piece::kNone) ? piece.supposition :
+    kFeatureUnknown;
+}
+
+void Ai::DeduceOpponentsKinds() {
+  // Start over if a move was missed, since pieces are followed by moves.
+  if (num_deduced_logs_ != board()->num_logs() - 1) {
+    for (int y = 0; y < Board::kHeight; ++y) {
+      for (int x = 0; x < Board::kWidth; ++x)
+        candidates_[y][x] = kAllKinds;
+    }
+  }
+  num_deduced_logs_ = board()->num_logs();
+
+  // Squares are raw, in which a headquarters is at the left one.
+  const Move kMove = board()->prev_move();
+  Point src = kMove.src;
+  Point dest = kMove.dest;
+  if (board()->IsDummyHeadquarters(src))
+    --src.x;
+  if (board()->IsDummyHeadquarters(dest))
+    --dest.x;
+  const Board::Piece kSrcPiece = board()->prev_src_piece();
+  const Board::Piece kDestPiece = board()->prev_dest_piece();
+  const Board::Piece kCurrentPiece = board()->board(kMove.dest);
+
+  // A piece of the opponent at destination won the battle if there was
+  // one. A flag is as strong as the piece at the back of it, so it may
+  // win or lose.
+  uint32_t kinds = kAllKinds;
+  if (kSrcPiece.characters_id == opponents_id()) {
+    kinds = 0;
+    for (int i = 0; i < Board::Piece::kNumKindPieces; ++i) {
+      Board::Piece piece = kSrcPiece;
+      piece.piece = static_cast<Board::Piece::KindPiece>(i);
+      if (piece.IsMovable() && board()->CanReachAs(kMove, piece) &&
+          (!kDestPiece.IsPiece() ||
+           kDestPiece.piece == Board::Piece::kFlag ||
+           Board::kBattleTable[i][kDestPiece.piece] == Board::kW)) {
+        kinds |= 1U << i;
+      }
+    }
+    kinds &= candidates_[src.y][src.x];
+  } else if (kDestPiece.IsPiece()) {
+    kinds = 0;
+    for (int i = 0; i < Board::Piece::kNumKindPieces; ++i) {
+      if (i == Board::Piece::kFlag ||
+          Board::kBattleTable[kSrcPiece.piece][i] == Board::kL) {
+        kinds |= 1U << i;
+      }
+    }
+    kinds &= candidates_[dest.y][dest.x];
+  }
+  // Results which contradict are forgotten.
+  bool opponent_is_at_dest = (kCurrentPiece.IsPiece() &&
+                              kCurrentPiece.characters_id == opponents_id());
+  candidates_[src.y][src.x] = kAllKinds;
+  candidates_[dest.y][dest.x] =
+    (opponent_is_at_dest && kinds != 0) ? kinds : kAllKinds;
+
+  // A kind deduced for as many pieces as the opponent has is none of the
+  // others, which may deduce more of them.
+  const Board::Squares &kSquares = board()->squares();
+  bool is_changed = true;
+  while (is_changed) {
+    is_changed = false;
+    int num_deduced_pieces[Board::Piece::kNumKindPieces] = {};
+    for (int y = 0; y < Board::kHeight; ++y) {
+      for (int x = 0; x < Board::kWidth; ++x) {
+        Board::Piece::KindPiece kind = KindOf(candidates_[y][x]);
+        if (kSquares[y][x].IsPiece() &&
+            kSquares[y][x].characters_id == opponents_id() &&
+            kind != Board::Piece::kNone) {
+          ++num_deduced_pieces[kind];
+        }
+      }
+    }
+    uint32_t excluded_kinds = 0;
+    for (int i = 0; i < Board::Piece::kNumKindPieces; ++i) {
+      if (Board::kNumEachPiece[i] <= num_deduced_pieces[i])
+        excluded_kinds |= 1U << i;
+    }
+    for (int y = 0; y < Board::kHeight; ++y) {
+      for (int x = 0; x < Board::kWidth; ++x) {
+        uint32_t &candidates = candidates_[y][x];
+        uint32_t rest = candidates & ~excluded_kinds;
+        if (kSquares[y][x].IsPiece() &&
+            kSquares[y][x].characters_id == opponents_id() &&
+            KindOf(candidates) == Board::Piece::kNone &&
+            rest != candidates && rest != 0) {
+          candidates = rest;
+          is_changed = true;
+        }
+      }
+    }
+  }
 }
 
 void Ai::SupposeOpponentsFormation(const Board::Piece &ais_piece) {
@@ -114,7 +981,11 @@ void Ai::SupposeOpponentsFormation(const Board::Piece &ais_piece) {
   if (ai_won)
     return;
 
-  // Suppose the opponent's piece.
+  // Suppose the opponent's piece. The flag of the ai is as strong as the
+  // piece at the back of it, which may be gone, so it tells nothing.
+  Board::Piece::KindPiece ais_kind_piece =
+    (ais_piece.piece == Board::Piece::kFlag) ?
+    Board::Piece::kNone : ais_piece.piece;
   Point difference = prev_move.dest.Subtract(prev_move.src);
   if (board()->prev_src_piece().characters_id == 0)
     difference = difference.Inverse();
@@ -127,22 +998,22 @@ void Ai::SupposeOpponentsFormation(const Board::Piece &ais_piece) {
     supposition = Board::Piece::kPlane;
   } else if (difference.y <= -2) {
     supposition = Board::Piece::kCavaly;
-    if (ais_piece.piece != Board::Piece::kNone) {
+    if (ais_kind_piece != Board::Piece::kNone) {
       for (int i = Board::Piece::kNumKindPieces - 3; 0 <= i; --i) {
         bool piece_can_go_ahead_2 = (i == Board::Piece::kPlane ||
                                      i == Board::Piece::kTank ||
                                      i == Board::Piece::kEngineer ||
                                      i == Board::Piece::kCavaly);
-        bool ai_lose = (!board()->kBattleTable[ais_piece.piece][i]);
+        bool ai_lose = (!board()->kBattleTable[ais_kind_piece][i]);
         if (piece_can_go_ahead_2 && ai_lose) {
           supposition = static_cast<Board::Piece::KindPiece>(i);
           break;
         }
       }
     }
-  } else if (ais_piece.piece != Board::Piece::kNone) {
+  } else if (ais_kind_piece != Board::Piece::kNone) {
     for (int i = Board::Piece::kNumKindPieces - 3; 0 <= i; --i) {
-      bool ai_lose = (!board()->kBattleTable[ais_piece.piece][i]);
+      bool ai_lose = (!board()->kBattleTable[ais_kind_piece][i]);
       if (ai_lose) {
         supposition = static_cast<Board::Piece::KindPiece>(i);
         break;
@@ -151,44 +1022,76 @@ void Ai::SupposeOpponentsFormation(const Board::Piece &ais_piece) {
   }
 
   // Set supposition into the piece.
-  current_piece.supposition =
-      std::min(current_piece.supposition, supposition);
-  board()->set_prev_dest(current_piece);
-  board()->set_board(current_piece, prev_move.dest);
+  board()->Suppose(prev_move.dest,
+                   std::min(current_piece.supposition, supposition));
 }
 
-void Ai::LoadFormationRandomly() {
-  FILE *file = fopen(kFormationFileUrl, "r");
-  if (!file) {
-    fprintf(stderr, "ERROR: %s is not existed.\n", kFormationFileUrl);
-    exit(-1);
+void Ai::SupposeFormationFromStats() {
+  // Only the first move of the opponent may be made.
+  FormationStats::Stats stats;
+  if (opponents_name_.empty() || 1 < board()->num_logs() ||
+      !FormationStats::Find(opponents_name_, &stats) ||
+      stats.num_games < kMinNumStatsGames) {
+    return;
   }
 
-  // Choose a formation randomly.
-  int num_formations;
-  fscanf(file, "%d", &num_formations);
-  int formation_id = rand() % num_formations;
+  for (int i = 0; i < FormationStats::kNumSquares; ++i) {
+    int kind = 0;
+    for (int j = 1; j < Board::Piece::kNumKindPieces; ++j) {
+      if (stats.counts[i][kind] < stats.counts[i][j])
+        kind = j;
+    }
+    // A supposition must be able to move and attack as the piece may,
+    // because it is the attacker of "Board::kBattleTable" in the search.
+    if (2 * stats.counts[i][kind] < stats.num_games ||
+        kind == Board::Piece::kMine || kind == Board::Piece::kFlag) {
+      continue;
+    }
+
+    // Follow the piece if it has moved.
+    Point p = FormationStats::PointOf(i, opponents_id());
+    if (board()->IsDummyHeadquarters(p))
+      continue;
+    if (board()->prev_move_is_initialized() &&
+        board()->prev_move().src.Equals(p)) {
+      p = board()->prev_move().dest;
+    }
+    Board::Piece piece = board()->board(p);
+    if (piece.characters_id != opponents_id() || !piece.IsPiece())
+      continue;
+    board()->Presume(p, std::min(piece.supposition,
+                                 static_cast<Board::Piece::KindPiece>(kind)));
+  }
+}
 
-  // Skip untill the choosen formation.
-  int size_board = Board::kWidth * Board::kHeight / 2;
-  for (int i = 0, dummy; i < size_board * formation_id; ++i)
-    fscanf(file, "%d", &dummy);
+bool Ai::PlaceFormation(const std::vector<int> &formation) {
+  if (static_cast<int>(formation.size()) != kSizeFormation)
+    return false;
+
+  // Check the whole formation before placing any piece. Both squares of
+  // headquarters have the same kind, which is counted once.
+  const int kHeadquarters = Board::kWidth / 2 - 1;
+  int num_each_piece[Board::Piece::kNumKindPieces] = {0};
+  for (int i = 0; i < kSizeFormation; ++i) {
+    int kind_piece = formation[i];
+    if (kind_piece < Board::Piece::kTaisho || Board::Piece::kFlag < kind_piece)
+      return false;
+    if (i == kHeadquarters + 1) {
+      if (kind_piece != formation[kHeadquarters])
+        return false;
+    } else if (Board::kNumEachPiece[kind_piece] <
+               ++num_each_piece[kind_piece]) {
+      return false;
+    }
+  }
 
-  // Load the formation.
   for (int y = 0; y < Board::kHeight / 2; ++y) {
     for (int x = 0; x < Board::kWidth; ++x) {
       Board::Piece piece;
       piece.characters_id = id();
       piece.supposition = Board::Piece::kNone;
-
-      // Read a piece.
-      int temp_kind_piece;
-      fscanf(file, "%d", &temp_kind_piece);
-      piece.piece = static_cast<Board::Piece::KindPiece>(temp_kind_piece);
-      if (!piece.IsPiece()) {
-        fprintf(stderr, "ERROR: The formation file is unavailable.\n");
-        exit(-1);
-      }
+      piece.piece = static_cast<Board::Piece::KindPiece>(
+          formation[y * Board::kWidth + x]);
 
       // Place a piece.
       Point dest = {(id() == 0) ? y : Board::kHeight - 1 - y,
@@ -197,7 +1100,105 @@ void Ai::LoadFormationRandomly() {
     }
   }
 
-  fclose(file);
+  return true;
+}
+
+const std::vector<std::vector<int> > &Ai::formations() {
+  // Initialization of a local static variable is thread-safe.
+  static const std::vector<std::vector<int> > formations = LoadFormations();
+  return formations;
+}
+
+Ai::SearchLimits Ai::LimitsOf(Level level) {
+  return kLevelLimits[level];
+}
+
+bool Ai::ParseLevel(const std::string &name, Level *level) {
+  for (int i = 0; i < kNumLevels; ++i) {
+    if (name == kLevelNames[i]) {
+      *level = static_cast<Level>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+const std::vector<int> &Ai::default_weights() {
+  static const std::vector<int> weights = LoadWeights();
+  return weights;
+}
+
+bool Ai::ParseWeights(const std::string &data, std::vector<int> *weights) {
+  std::istringstream stream(data);
+  int num_weights = 0;
+  if (!(stream >> num_weights) || num_weights != kNumFeatures)
+    return false;
+
+  weights->resize(kNumFeatures);
+  for (int i = 0; i < kNumFeatures; ++i) {
+    int max_weight = (i < kFeatureMaterial) ? kMaxStrengthWeight :
+      kMaxMaterialWeight;
+    if (!(stream >> (*weights)[i]) || abs((*weights)[i]) > max_weight)
+      return false;
+  }
+
+  return true;
+}
+
+std::vector<std::vector<int> > Ai::LoadFormations() {
+  // The book may be embedded.
+  std::string data;
+  if (!Resources::Read(kFormationFileName, &data)) {
+    fprintf(stderr, "ERROR: %s is not existed.\n",
+            Resources::ToPath(kFormationFileName).c_str());
+    exit(-1);
+  }
+
+  // Load all formations.
+  std::istringstream stream(data);
+  std::vector<std::vector<int> > formations;
+  int num_formations = 0;
+  stream >> num_formations;
+  formations.resize(num_formations, std::vector<int>(kSizeFormation));
+  for (int i = 0; i < num_formations; ++i) {
+    for (int j = 0; j < kSizeFormation; ++j) {
+      if (!(stream >> formations[i][j])) {
+        fprintf(stderr, "ERROR: The formation file is unavailable.\n");
+        exit(-1);
+      }
+    }
+  }
+
+  return formations;
+}
+
+std::vector<int> Ai::LoadWeights() {
+  // Weights may be embedded.
+  std::string data;
+  if (!Resources::Read(kWeightFileName, &data)) {
+    fprintf(stderr, "ERROR: %s is not existed.\n",
+            Resources::ToPath(kWeightFileName).c_str());
+    exit(-1);
+  }
+
+  std::vector<int> weights;
+  if (!ParseWeights(data, &weights)) {
+    fprintf(stderr, "ERROR: The weight file is unavailable.\n");
+    exit(-1);
+  }
+
+  return weights;
+}
+
+void Ai::LoadFormationRandomly() {
+  // Choose a formation randomly.
+  const std::vector<std::vector<int> > &kFormations = formations();
+  int formation_id =
+      board()->random().Next(static_cast<int>(kFormations.size()));
+  if (!PlaceFormation(kFormations[formation_id])) {
+    fprintf(stderr, "ERROR: The formation file is unavailable.\n");
+    exit(-1);
+  }
 }
 
 void Ai::ReplaceSomePiecesRandomly() {
@@ -205,7 +1206,7 @@ void Ai::ReplaceSomePiecesRandomly() {
     return;
 
   // Determine the number of times to swap pieces.
-  int num_times = rand() % kMaxTimesSwapPiecesRandomly;
+  int num_times = board()->random().Next(kMaxTimesSwapPiecesRandomly);
 
   // Swap pieces.
   for (int i = 0; i < num_times; ++i) {
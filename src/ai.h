@@ -5,28 +5,296 @@
 #ifndef GUNJIN_SHOGI_AI_H_
 #define GUNJIN_SHOGI_AI_H_
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
 #include <string>
 #include <vector>
 #include "character.h"
+#include "endgame_solver.h"
 
 struct Point;
 class Board;
+class AiScheduler;
 class Ai : public Character {
 public:
+  struct SearchLimits {
+    // Zero means unlimited. A search returns the best move so far when
+    // either is hit, including the time for the endgame solver.
+    int max_num_nodes;
+    int max_milliseconds;
+    // Zero means "kDefaultDepth".
+    int max_depth;
+  };
+  struct SearchInfo {
+    int num_nodes;
+    int milliseconds;
+    int evaluation_value;
+    // Of the last iteration which finished.
+    int depth;
+    // Beta cutoffs, and those by the first move, which show how well
+    // moves are ordered.
+    int num_cutoffs;
+    int num_first_move_cutoffs;
+    // Of the extension over battles after each move.
+    int num_quiescence_nodes;
+    int max_quiescence_depth;
+    int num_stand_pats;
+    int num_delta_prunes;
+    // Boards evaluated in the search, and those found in the cache.
+    int num_evaluations;
+    int num_evaluation_hits;
+    // "kUnknown" unless the endgame solver proved the result.
+    EndgameSolver::Value endgame_value;
+  };
+  // Difficulty levels, which are budgets of a search for each move.
+  enum Level {
+    kBeginner,
+    kEasy,
+    kNormal,
+    kHard,
+    kNumLevels,
+  };
+  // One of the best moves found by "Analyze()".
+  struct Line {
+    Move move;
+    int evaluation_value;
+    // Moves of both characters from "move", as far as they are known.
+    std::vector<Move> principal_variation;
+  };
+  struct Analysis {
+    int depth;
+    int num_nodes;
+    int milliseconds;
+    // From the best.
+    std::vector<Line> lines;
+  };
+
+  static const int kSizeFormation = Board::kWidth * Board::kHeight / 2;
+  static const int kDefaultDepth = 3;
+  // Moves are searched till this depth at most before battles.
+  static const int kMaxDepth = 16;
+  // The evaluation value of a proven win, less the plies to the end.
+  static const int kSolvedValue = 1 << 20;
+  // The evaluation value is the dot product of features and weights.
+  // A feature of a kind is the sum of the weights of the squares of its
+  // pieces, negative for the opponent. Opponent's pieces without
+  // suppositions are unknown. The material is the difference of pieces.
+  // Tactical features are differences of the numbers of pieces which
+  // can be taken by a piece reaching them, and of pieces which can enter
+  // the headquarters, seen from the attack maps of the board.
+  static const int kFeatureUnknown = Board::Piece::kNumKindPieces;
+  static const int kFeatureMaterial = kFeatureUnknown + 1;
+  static const int kFeatureHanging = kFeatureMaterial + 1;
+  static const int kFeatureThreat = kFeatureHanging + 1;
+  static const int kNumFeatures = kFeatureThreat + 1;
+  // Keep values of "EvaluateMoves()" in 16 bits.
+  static const int kMaxStrengthWeight = 255;
+  static const int kMaxMaterialWeight = 1000;
+  static const char *kWeightFileName;
+  // Movable kinds taking at least half of the games of "FormationStats"
+  // are supposed once this many games are kept.
+  static const int kMinNumStatsGames = 3;
+
   Ai(Board *board, int id, const std::string &name)
-      : Character(kAi, board, id, name) {}
+      : Character(kAi, board, id, name),
+        is_stopped_(false),
+        num_deduced_logs_(-1),
+        stats_are_supposed_(false),
+        scheduler_(nullptr),
+        deadline_milliseconds_(0),
+        is_requested_(false),
+        is_moved_(false),
+        queueing_microseconds_(0),
+        computing_microseconds_(0),
+        weights_(default_weights()) {
+    search_limits_.max_num_nodes = 0;
+    search_limits_.max_milliseconds = 0;
+    search_limits_.max_depth = 0;
+  }
 
   void ReplacePieces();
   Move MovePiece();
+  // Moves within "limits" instead of "search_limits()".
+  Move MovePiece(const SearchLimits &limits);
+  // Moves on the scheduler if it is set. Otherwise this blocks.
+  TurnStatus ResumeMovePiece(Move *move);
+  // Updates suppositions with the result of the previous battle.
+  void Observe();
+  // Determines the best move without moving any piece.
+  // A proven endgame is played by the endgame solver, unless it is lost.
+  // "Stop()" before this is kept as "Analyze()".
+  Move Search(const SearchLimits &limits, SearchInfo *info);
+  // Evaluates the boards after each move of the ai in one pass, except
+  // for tactical features which need each move made if they are weighted.
+  // Values are the same as "EvaluateBoard()" after "SupposeBattle()".
+  void EvaluateMoves(const std::vector<Move> &moves,
+                     std::vector<int> *values);
+  // Searches the best "num_lines" moves of the ai deeper and deeper, and
+  // reports them after each depth till the limits or "Stop()". Zero depth
+  // means "kMaxDepth" here. "Stop()" before this is kept, so that it
+  // stops even if it is called right after starting this on another
+  // thread.
+  void Analyze(const SearchLimits &limits, int num_lines,
+               const std::function<void(const Analysis &)> &report);
+  // Makes a running search return the best move so far.
+  // This may be called from another thread.
+  void Stop() { is_stopped_ = true; }
+  // Lets the next search run after "Stop()". Call this before starting
+  // the search on another thread.
+  void ClearStop() { is_stopped_ = false; }
+  // Places a formation seen from the back row of the ai.
+  bool PlaceFormation(const std::vector<int> &formation);
+  // Features of the current board seen from the ai. The ai must be the
+  // supposer of the board.
+  void ExtractFeatures(int features[kNumFeatures]) const;
+
+  static SearchLimits LimitsOf(Level level);
+  // Parses a name of a level such as "normal".
+  static bool ParseLevel(const std::string &name, Level *level);
+  // Weights in "kWeightFileName" are loaded only once and copied by all ais.
+  static const std::vector<int> &default_weights();
+  // Returns false if the data is not weights in "kWeightFileName".
+  static bool ParseWeights(const std::string &data,
+                           std::vector<int> *weights);
+
+  // Used by "MovePiece()". The scheduler tightens them by its load.
+  const SearchLimits &search_limits() const { return search_limits_; }
+  void set_search_limits(const SearchLimits &limits) {
+    search_limits_ = limits;
+  }
+  void set_level(Level level) { set_search_limits(LimitsOf(level)); }
+  // Of the previous "MovePiece()".
+  const SearchInfo &search_info() const { return search_info_; }
+  const std::vector<int> &weights() const { return weights_; }
+  // The weights must be accepted by "ParseWeights()".
+  void set_weights(const std::vector<int> &weights) { weights_ = weights; }
+  // "moved" is called on a worker of the scheduler after the ai moved,
+  // to resume "ResumeMovePiece()".
+  void set_scheduler(AiScheduler *scheduler, int deadline_milliseconds,
+                     const std::function<void()> &moved) {
+    scheduler_ = scheduler;
+    deadline_milliseconds_ = deadline_milliseconds;
+    moved_ = moved;
+  }
+  // The opponent whose formations are learned by "FormationStats". They
+  // are supposed before the first move of the ai. Empty means unknown.
+  const std::string &opponents_name() const { return opponents_name_; }
+  void set_opponents_name(const std::string &name) { opponents_name_ = name; }
+  // Latency of the previous move on the scheduler.
+  int queueing_microseconds() const { return queueing_microseconds_; }
+  int computing_microseconds() const { return computing_microseconds_; }
 
 protected:
   static const int kMaxTimesSwapPiecesRandomly;
-  static const char *kFormationFileUrl;
+  static const char *kFormationFileName;
+  // Battles are searched till this depth at most.
+  static const int kMaxQuiescenceDepth = 8;
+
+  // Tables to order moves, which are shared by searches on a thread.
+  struct SearchTables;
+
+  // Candidate moves as structure of arrays for "EvaluateMoves()".
+  // The value of a move is the value of the current board plus
+  // "src_strength * src_weight + dest_strength * dest_weight + bonus".
+  struct MoveFeatures {
+    std::vector<int16_t> src_strength;
+    std::vector<int16_t> src_weight;
+    std::vector<int16_t> dest_strength;
+    std::vector<int16_t> dest_weight;
+    std::vector<int16_t> bonus;
+    std::vector<int16_t> difference;
+  };
+
+  // Formations are loaded only once and shared by all ais.
+  static const std::vector<std::vector<int> > &formations();
+  static std::vector<std::vector<int> > LoadFormations();
+  static std::vector<int> LoadWeights();
 
   int EvaluateBoard() const;
+  // "EvaluateBoard()" through the cache of the search, which is keyed by
+  // the hash of the board including suppositions.
+  int EvaluateCachedBoard();
+  // Starts measuring a search into "info".
+  void StartSearch(const SearchLimits &limits, SearchInfo *info);
+  int CountMilliseconds() const;
+  // Generates moves of the ai within the node limit into "moves_",
+  // and orders them by the static values into "order_".
+  void OrderRootMoves(const SearchLimits &limits);
+  // Follows the hash moves from "move" within "depth" plies.
+  void ExtractPrincipalVariation(const Move &move, int depth,
+                                 std::vector<Move> *moves);
+  // Returns the value of the board for "characters_id" to move.
+  int AlphaBeta(int depth, int alpha, int beta, int characters_id, int ply);
+  // Orders moves by the hash move, battles by the expected results,
+  // killer moves and the history in this order.
+  void ScoreMoves(int characters_id, int ply, const std::vector<Move> &moves,
+                  std::vector<int> *scores) const;
+  // Remembers a move which caused a beta cutoff.
+  void RecordCutoff(const Move &move, int depth, int ply);
+  uint64_t HashKeyOf(int characters_id) const;
+  // Returns the value of the board for "characters_id" to move,
+  // searching only moves onto the other's pieces till they are quiet.
+  int Quiesce(int alpha, int beta, int characters_id, int depth);
+  // Appends moves of "characters_id" onto the other's pieces.
+  void GenerateCaptures(int characters_id, std::vector<Move> *moves) const;
+  // Upper bound of how much a move raises the evaluation value.
+  int EstimateMaxGain(const Move &move) const;
+  bool IsSearchEnd() const;
+  // Solves the board if opponent's pieces are few and all deduced, so that
+  // the result is proven.
+  bool SolveEndgame(int max_milliseconds,
+                    EndgameSolver::Result *result) const;
+  // The feature which a piece seen from the ai belongs to.
+  int FeatureOf(const Board::Piece &piece) const;
+  // The kind of a piece seen from the ai. Unknown pieces are guessed.
+  Board::Piece::KindPiece GuessKindOf(const Board::Piece &piece) const;
+  void ExtractTacticalFeatures(int features[kNumFeatures]) const;
+  // Narrows the kinds of the opponent's pieces by the previous move.
+  void DeduceOpponentsKinds();
   void SupposeOpponentsFormation(const Board::Piece &ais_piece);
+  // Supposes the frequent kinds of the opponent's formations in
+  // "FormationStats", followed by the first move of the opponent if any.
+  // They are presumed before the search, which never undoes the game.
+  void SupposeFormationFromStats();
   void LoadFormationRandomly();
   void ReplaceSomePiecesRandomly();
+
+  std::atomic<bool> is_stopped_;
+  // Kinds which each piece of the opponent can be, as bits of
+  // "1 << kind", deduced only from the moves and the battles seen by
+  // "Observe()". Squares are raw. They are up to date if the board has
+  // "num_deduced_logs_" logs.
+  uint32_t candidates_[Board::kHeight][Board::kWidth];
+  int num_deduced_logs_;
+  std::string opponents_name_;
+  bool stats_are_supposed_;
+  SearchLimits search_limits_;
+  SearchInfo search_info_;
+  // Reused not to allocate them in every search.
+  std::vector<Move> moves_;
+  std::vector<int> values_;
+  std::vector<int> order_;
+  MoveFeatures features_;
+  std::vector<Move> captures_[kMaxQuiescenceDepth];
+  std::vector<Move> moves_by_ply_[kMaxDepth];
+  std::vector<int> scores_by_ply_[kMaxDepth];
+  // Of the running search.
+  SearchLimits limits_;
+  SearchInfo *info_;
+  SearchTables *tables_;
+  std::chrono::steady_clock::time_point start_;
+
+  AiScheduler *scheduler_;
+  int deadline_milliseconds_;
+  std::function<void()> moved_;
+  bool is_requested_;
+  std::atomic<bool> is_moved_;
+  Move scheduled_move_;
+  int queueing_microseconds_;
+  int computing_microseconds_;
+  std::vector<int> weights_;
 };
 
 #endif  // GUNJIN_SHOGI_AI_H_
\ No newline at end of file
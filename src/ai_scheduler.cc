@@ -0,0 +1,109 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016 Hirotaka Nagashima. All rights reserved.
+//-----------------------------------------------------------------------------
+// Information on this class is described in "ai_scheduler.h".
+//-----------------------------------------------------------------------------
+
+#include "ai_scheduler.h"
+#include <algorithm>
+
+namespace {
+
+int ToMicroseconds(AiScheduler::Clock::duration duration) {
+  return static_cast<int>(
+      std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+}
+
+// The tighter one of limits, where zero means unlimited.
+int Tighten(int limit, int other_limit) {
+  if (limit == 0 || other_limit == 0)
+    return std::max(limit, other_limit);
+  return std::min(limit, other_limit);
+}
+
+}  // namespace
+
+AiScheduler::AiScheduler(int num_workers, const Ai::SearchLimits &limits)
+    : kNumWorkers(num_workers),
+      kLimits(limits),
+      statistics_(),
+      workers_(num_workers) {}
+
+void AiScheduler::Request(Ai *ai, int deadline_milliseconds,
+                          const std::function<void(const Result &)> &done) {
+  Task task;
+  task.ai = ai;
+  task.requested = Clock::now();
+  task.deadline = task.requested +
+      std::chrono::milliseconds(deadline_milliseconds);
+  task.done = done;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.push(task);
+  }
+
+  // Each posted run takes the most urgent task at that time.
+  workers_.Post([this]() { Run(); });
+}
+
+AiScheduler::Statistics AiScheduler::statistics() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return statistics_;
+}
+
+void AiScheduler::Run() {
+  // Take the task with the earliest deadline.
+  Task task;
+  int num_waiting_tasks;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    task = tasks_.top();
+    tasks_.pop();
+    num_waiting_tasks = static_cast<int>(tasks_.size());
+  }
+  const Clock::time_point kStart = Clock::now();
+
+  // Shrink the limits of the ai by those of the scheduler and the load,
+  // and keep the search within the deadline.
+  Ai::SearchLimits limits = task.ai->search_limits();
+  limits.max_num_nodes = Tighten(limits.max_num_nodes, kLimits.max_num_nodes);
+  limits.max_milliseconds =
+    Tighten(limits.max_milliseconds, kLimits.max_milliseconds);
+  limits.max_depth = Tighten(limits.max_depth, kLimits.max_depth);
+  int load = 1 + num_waiting_tasks / kNumWorkers;
+  if (limits.max_num_nodes != 0)
+    limits.max_num_nodes = std::max(1, limits.max_num_nodes / load);
+  int remaining_milliseconds = static_cast<int>(
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          task.deadline - kStart).count());
+  remaining_milliseconds = std::max(1, remaining_milliseconds);
+  if (limits.max_milliseconds != 0)
+    limits.max_milliseconds = std::max(1, limits.max_milliseconds / load);
+  limits.max_milliseconds = (limits.max_milliseconds == 0) ?
+      remaining_milliseconds :
+      std::min(limits.max_milliseconds, remaining_milliseconds);
+
+  // Move a piece.
+  Result result;
+  result.move = task.ai->MovePiece(limits);
+  result.info = task.ai->search_info();
+  const Clock::time_point kEnd = Clock::now();
+  result.queueing_microseconds = ToMicroseconds(kStart - task.requested);
+  result.computing_microseconds = ToMicroseconds(kEnd - kStart);
+
+  // Update statistics.
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++statistics_.num_requests;
+    if (task.deadline < kEnd)
+      ++statistics_.num_late_requests;
+    statistics_.sum_queueing_microseconds += result.queueing_microseconds;
+    statistics_.sum_computing_microseconds += result.computing_microseconds;
+    statistics_.max_queueing_microseconds = std::max(
+        statistics_.max_queueing_microseconds, result.queueing_microseconds);
+    statistics_.max_computing_microseconds = std::max(
+        statistics_.max_computing_microseconds, result.computing_microseconds);
+  }
+
+  task.done(result);
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016 Hirotaka Nagashima. All rights reserved.
+//-----------------------------------------------------------------------------
+// This class moves pieces of many ais on a fixed number of threads.
+// A request with the earliest deadline is run first, and the limits of
+// a search shrink as requests queue up. A move is returned by its
+// deadline, because the time of a search is limited strictly.
+//-----------------------------------------------------------------------------
+
+#ifndef GUNJIN_SHOGI_AI_SCHEDULER_H_
+#define GUNJIN_SHOGI_AI_SCHEDULER_H_
+
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <vector>
+#include "ai.h"
+#include "worker_pool.h"
+
+class AiScheduler {
+public:
+  typedef std::chrono::steady_clock Clock;
+
+  struct Result {
+    Move move;
+    Ai::SearchInfo info;
+    // From the request till a worker starts it.
+    int queueing_microseconds;
+    // Of "Ai::MovePiece()".
+    int computing_microseconds;
+  };
+  struct Statistics {
+    int num_requests;
+    int num_late_requests;
+    int64_t sum_queueing_microseconds;
+    int64_t sum_computing_microseconds;
+    int max_queueing_microseconds;
+    int max_computing_microseconds;
+  };
+
+  // The limits of each ai are tightened by "limits" when no request is
+  // waiting, and more as requests queue up.
+  AiScheduler(int num_workers, const Ai::SearchLimits &limits);
+
+  // Moves a piece of the ai. "done" is called on a worker.
+  // The ai must not be used till then. Thread-safe.
+  void Request(Ai *ai, int deadline_milliseconds,
+               const std::function<void(const Result &)> &done);
+
+  // Thread-safe.
+  Statistics statistics();
+
+private:
+  struct Task {
+    // For std::priority_queue, which pops the largest one.
+    bool operator<(const Task &task) const {
+      return (task.deadline < deadline);
+    }
+
+    Ai *ai;
+    Clock::time_point requested;
+    Clock::time_point deadline;
+    std::function<void(const Result &)> done;
+  };
+
+  // Called on a worker.
+  void Run();
+
+  const int kNumWorkers;
+  const Ai::SearchLimits kLimits;
+  std::mutex mutex_;
+  std::priority_queue<Task> tasks_;
+  Statistics statistics_;
+  // Declared last to be destroyed first.
+  WorkerPool workers_;
+};
+
+#endif  // GUNJIN_SHOGI_AI_SCHEDULER_H_
\ No newline at end of file
@@ -7,6 +7,9 @@
 #include "board.h"
 #include <cmath>
 #include <cassert>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
 
 const Point Board::kEntrances[kNumEntrances] = {
     {3, 1}, {3, 4}, {4, 1}, {4, 4}};
@@ -57,7 +60,7 @@ void Board::Initialize() {
         // Create a random kind of piece.
         do {
           piece.piece = static_cast<Piece::KindPiece>(
-              rand() % Piece::kNumKindPieces);
+              random_.Next(Piece::kNumKindPieces));
         } while (kNumEachPiece[piece.piece] <=
                  count_each_piece[piece.piece]);
         ++count_each_piece[piece.piece];
@@ -67,6 +70,8 @@ void Board::Initialize() {
       board_[y][x] = piece;
     }
   }
+  num_logs_ = 0;
+  Rehash();
 
   // If the board is invalid.
   for (int id = 0; id < kNumPlayers; ++id) {
@@ -82,6 +87,32 @@ void Board::Initialize() {
   }
 }
 
+void Board::Load(const Squares &squares) {
+  memcpy(board_, squares, sizeof(board_));
+  num_logs_ = 0;
+  Rehash();
+}
+
+bool Board::IsLoadable(const Squares &squares) {
+  int num_each_piece[kNumPlayers][Piece::kNumKindPieces] = {};
+  for (int y = 0; y < kHeight; ++y) {
+    for (int x = 0; x < kWidth; ++x) {
+      const Piece &kPiece = squares[y][x];
+      bool is_dummy_headquarters = ((y == 0 || y == kHeight - 1) &&
+                                    x == kWidth / 2);
+      if (!kPiece.IsValid() || is_dummy_headquarters !=
+          (kPiece.piece == Piece::kDummyHeadquarters)) {
+        return false;
+      }
+      if (kPiece.IsPiece() && kNumEachPiece[kPiece.piece] <
+          ++num_each_piece[kPiece.characters_id][kPiece.piece]) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
 void Board::Battle(const Move &move) {
   const Piece kSrcPiece = board(move.src);
   const Piece kDestPiece = board(move.dest);
@@ -134,6 +165,22 @@ void Board::Battle(const Move &move) {
   }
 }
 
+void Board::ReportBattle(const Move &move, BattleResult result) {
+  const Piece kSrcPiece = board(move.src);
+
+  // Log.
+  add_log(move);
+
+  // Delete pieces.
+  Delete(move.src);
+  switch (result) {
+  case kL: break;
+  case kW: set_board(kSrcPiece, move.dest); break;
+  case kD: Delete(move.dest); break;
+  default: assert(true);
+  }
+}
+
 bool Board::IsValid(int characters_id, std::vector<Point> *error) const {
   bool is_available = true;
 
@@ -162,24 +209,39 @@ bool Board::IsValid(int characters_id, std::vector<Point> *error) const {
 }
 
 bool Board::IsMoveValid(const Move &move) const {
-  const Piece kSrcPiece = board(move.src);
+  return IsMoveValidAs(move, board(move.src));
+}
+
+bool Board::IsSupposedMoveValid(const Move &move) const {
+  return IsMoveValidAs(move, SupposedPieceOf(board(move.src)));
+}
+
+bool Board::IsMoveValidAs(const Move &move, const Piece &src_piece) const {
   const Piece kDestPiece = board(move.dest);
 
   // Check whether the piece at source is movable.
-  if (!kSrcPiece.IsMovable())
+  if (!src_piece.IsMovable())
     return false;
 
   // Check whether pieces at destination and source
   // belong to same characters.
-  if (kSrcPiece.characters_id == kDestPiece.characters_id &&
+  if (src_piece.characters_id == kDestPiece.characters_id &&
       kDestPiece.IsPiece()) {
     return false;
   }
 
+  return CanReachAs(move, src_piece);
+}
+
+bool Board::CanReach(const Move &move) const {
+  return CanReachAs(move, board(move.src));
+}
+
+bool Board::CanReachAs(const Move &move, const Piece &src_piece) const {
   // Calculate differencial vector.
   Point difference = move.dest.Subtract(move.src);
   // If a board was rotated 180 degrees.
-  if (kSrcPiece.characters_id == 0)
+  if (src_piece.characters_id == 0)
     difference = difference.Inverse();
 
   // If the piece moves diagonally or doesn't move.
@@ -191,7 +253,7 @@ bool Board::IsMoveValid(const Move &move) const {
   bool piece_hits_obstacle = IsPieceHittingObstacle(move);
   bool y_is_in_range = (abs(difference.y) == 1);
   bool x_is_in_range = (abs(difference.x) == 1);
-  switch (kSrcPiece.piece) {
+  switch (src_piece.piece) {
   case Piece::kTank:  // front:2, others:1
   case Piece::kCavaly:
     y_is_in_range |= (difference.y == -2);
@@ -207,6 +269,36 @@ bool Board::IsMoveValid(const Move &move) const {
   }
 }
 
+void Board::GenerateMoves(int characters_id,
+                          std::vector<Move> *moves) const {
+  Point p;
+  for (p.y = 0; p.y < kHeight; ++p.y) {
+    for (p.x = 0; p.x < kWidth; ++p.x) {
+      Piece piece = SupposedPieceOf(board(p));
+      if (piece.characters_id != characters_id || !piece.IsMovable() ||
+          IsDummyHeadquarters(p)) {
+        continue;
+      }
+
+      // Destinations are in the attack map. Headquarters is entered
+      // through the real square if it can, and a piece in headquarters
+      // moves from the square which the move is valid from.
+      uint64_t squares = reach(p);
+      for (uint64_t bits = squares; bits != 0; bits &= bits - 1) {
+        Move move = {p, PointOf(__builtin_ctzll(bits))};
+        if (IsDummyHeadquarters(move.dest) &&
+            (squares & (BitOf(move.dest) >> 1)) != 0) {
+          continue;
+        }
+        if (!IsSupposedMoveValid(move) && ExistHeadquartersAt(move.src))
+          ++move.src.x;
+        if (IsSupposedMoveValid(move))
+          moves->push_back(move);
+      }
+    }
+  }
+}
+
 bool Board::IsEnd(int *winners_id, bool *game_was_drawn) const {
   // Check which character win.
   *game_was_drawn = false;
@@ -248,6 +340,48 @@ bool Board::IsEnd(int *winners_id, bool *game_was_drawn) const {
   return false;
 }
 
+bool Board::IsAdjudicated(int max_num_plies,
+                          int *winners_id, bool *game_was_drawn) const {
+  *game_was_drawn = false;
+
+  // Check whether the same position appears too many times.
+  if (kMaxNumRepetitions <= CountRepetitions() + 1) {
+    *game_was_drawn = true;
+    return true;
+  }
+
+  // Check whether the game is too long.
+  if (num_logs_ < max_num_plies)
+    return false;
+
+  // Judge with the number of pieces.
+  int difference = CountNumPieces(0) - CountNumPieces(1);
+  if (difference == 0)
+    *game_was_drawn = true;
+  else
+    *winners_id = (0 < difference) ? 0 : 1;
+  return true;
+}
+
+int Board::CountRepetitions() const {
+  // Compare positions with the same side to move.
+  int num_repetitions = 0;
+  for (int i = num_logs_ - 2; 0 <= i; i -= 2) {
+    const Log &log = logs_[i];
+
+    // A position before a battle never appears again.
+    if (log.num_pieces[0] != num_pieces_[0] ||
+        log.num_pieces[1] != num_pieces_[1]) {
+      break;
+    }
+
+    if (log.hash == hash_)
+      ++num_repetitions;
+  }
+
+  return num_repetitions;
+}
+
 bool Board::IsPieceHittingObstacle(const Move &move) const {
   const Point kDifference = move.dest.Subtract(move.src);
 
@@ -277,19 +411,84 @@ bool Board::IsPieceHittingObstacle(const Move &move) const {
   return false;
 }
 
-int Board::CountNumPieces(int characters_id) const {
-  // Count the number of player's pieces.
-  int num_pieces = 0;
+void Board::Rehash() {
+  hash_ = 0;
+  supposition_hash_ = 0;
+  num_pieces_[0] = num_pieces_[1] = 0;
+  memset(reaches_, 0, sizeof(reaches_));
+  memset(attackers_, 0, sizeof(attackers_));
+  uint64_t squares = 0;
   Point p;
   for (p.y = 0; p.y < kHeight; ++p.y) {
     for (p.x = 0; p.x < kWidth; ++p.x) {
-      Piece piece = board(p);
-      if (piece.characters_id == characters_id && piece.IsPiece())
-        ++num_pieces;
+      Piece piece = board_[p.y][p.x];
+      hash_ ^= HashOf(piece, p);
+      supposition_hash_ ^= SuppositionHashOf(piece, p);
+      if (piece.IsPiece()) {
+        ++num_pieces_[piece.characters_id];
+        squares |= BitOf(p);
+      }
     }
   }
+  AddReaches(squares);
+}
 
-  return num_pieces;
+void Board::RemoveReaches(uint64_t squares) {
+  for (; squares != 0; squares &= squares - 1) {
+    int bit = __builtin_ctzll(squares);
+    Point p = PointOf(bit);
+    int id = board_[p.y][p.x].characters_id;
+    for (uint64_t reach = reaches_[p.y][p.x]; reach != 0;
+         reach &= reach - 1) {
+      Point dest = PointOf(__builtin_ctzll(reach));
+      attackers_[id][dest.y][dest.x] &= ~(1ULL << bit);
+    }
+    reaches_[p.y][p.x] = 0;
+  }
+}
+
+void Board::AddReaches(uint64_t squares) {
+  for (; squares != 0; squares &= squares - 1) {
+    int bit = __builtin_ctzll(squares);
+    Point p = PointOf(bit);
+    const Piece &kPiece = board_[p.y][p.x];
+    if (!SupposedPieceOf(kPiece).IsMovable())
+      continue;
+
+    uint64_t reach = ComputeReach(p);
+    reaches_[p.y][p.x] = reach;
+    for (; reach != 0; reach &= reach - 1) {
+      Point dest = PointOf(__builtin_ctzll(reach));
+      attackers_[kPiece.characters_id][dest.y][dest.x] |= 1ULL << bit;
+    }
+  }
+}
+
+uint64_t Board::ComputeReach(const Point &p) const {
+  const Piece kPiece = SupposedPieceOf(board_[p.y][p.x]);
+
+  // A piece in headquarters moves from both of its squares.
+  Move move;
+  uint64_t reach = 0;
+  int num_srcs = ExistHeadquartersAt(p) ? 2 : 1;
+  for (int i = 0; i < num_srcs; ++i) {
+    move.src.y = p.y;
+    move.src.x = p.x + i;
+
+    // Pieces move only straight.
+    for (move.dest.y = 0; move.dest.y < kHeight; ++move.dest.y) {
+      move.dest.x = move.src.x;
+      if (move.dest.y != p.y && CanReachAs(move, kPiece))
+        reach |= BitOf(move.dest);
+    }
+    move.dest.y = move.src.y;
+    for (move.dest.x = 0; move.dest.x < kWidth; ++move.dest.x) {
+      bool is_src = (move.dest.x == p.x || move.dest.x == p.x + num_srcs - 1);
+      if (!is_src && CanReachAs(move, kPiece))
+        reach |= BitOf(move.dest);
+    }
+  }
+  return reach;
 }
 
 int Board::CountNumPlaceableSquares(const Point &src) const {
@@ -311,35 +510,18 @@ int Board::CountNumPlaceableSquares(const Point &src) const {
 }
 
 void Board::DeterminePointRandomly(int id, Point *point) const {
-  point->y = rand() % (Board::kHeight / 2);
+  point->y = random_.Next(Board::kHeight / 2);
   point->y += (id == 1) ? Board::kHeight / 2 : 0;
-  point->x = rand() % Board::kWidth;
+  point->x = random_.Next(Board::kWidth);
 }
 
 void Board::SupposeBattle(int supposer_id, const Move &move) {
   const Piece kSrcPiece = board(move.src);
-  const Piece kDestPiece = board(move.dest);
-  const Piece::KindPiece kSrcKindPiece =
-    (kSrcPiece.characters_id == supposer_id) ?
-    kSrcPiece.piece : kSrcPiece.supposition;
-  const Piece::KindPiece kDestKindPiece =
-    (kDestPiece.characters_id == supposer_id) ?
-    kDestPiece.piece : kDestPiece.supposition;
+  BattleResult result = SupposeBattleResult(supposer_id, move);
 
   // Log.
   add_log(move);
 
-  // Check which piece is stronger.
-  BattleResult result = kW;
-  switch (kDestKindPiece) {
-  case Piece::kNone:
-    result = kW;
-    break;
-  default:
-    result = kBattleTable[kSrcKindPiece][kDestKindPiece];
-    break;
-  }
-
   // Delete pieces.
   Delete(move.src);
   switch (result) {
@@ -350,6 +532,59 @@ void Board::SupposeBattle(int supposer_id, const Move &move) {
   }
 }
 
+Board::BattleResult Board::SupposeBattleResult(int supposer_id,
+                                               const Move &move) const {
+  const Piece kSrcPiece = board(move.src);
+  const Piece kDestPiece = board(move.dest);
+  Piece::KindPiece src_kind_piece =
+    (kSrcPiece.characters_id == supposer_id) ?
+    kSrcPiece.piece : kSrcPiece.supposition;
+  Piece::KindPiece dest_kind_piece =
+    (kDestPiece.characters_id == supposer_id) ?
+    kDestPiece.piece : kDestPiece.supposition;
+  // An unknown piece moving is supposed to be the middle of ranks.
+  if (src_kind_piece == Piece::kNone)
+    src_kind_piece = Piece::kChusa;
+  // The flag is as strong as the piece at the back of it.
+  if (dest_kind_piece == Piece::kFlag) {
+    Point back = {move.dest.y + (kDestPiece.characters_id == 0 ? -1 : 1),
+                  move.dest.x};
+    dest_kind_piece = Piece::kNone;
+    if (0 <= back.y && back.y < kHeight) {
+      Piece back_flag = board(back);
+      if (back_flag.IsPiece() &&
+          back_flag.characters_id == kDestPiece.characters_id) {
+        dest_kind_piece = (back_flag.characters_id == supposer_id) ?
+          back_flag.piece : back_flag.supposition;
+      }
+    }
+  }
+
+  // Check which piece is stronger.
+  if (dest_kind_piece == Piece::kNone)
+    return kW;
+  return kBattleTable[src_kind_piece][dest_kind_piece];
+}
+
+void Board::Suppose(const Point &p, Piece::KindPiece supposition) {
+  // Record the previous supposition to revert it.
+  if (prev_move_is_initialized()) {
+    Log &prev = logs_[num_logs_ - 1];
+    assert(prev.num_beliefs < kMaxNumBeliefs);
+    Belief &belief = prev.beliefs[prev.num_beliefs++];
+    belief.point = p;
+    belief.prev_supposition = board(p).supposition;
+  }
+
+  Presume(p, supposition);
+}
+
+void Board::Presume(const Point &p, Piece::KindPiece supposition) {
+  Piece piece = board(p);
+  piece.supposition = supposition;
+  set_board(piece, p);
+}
+
 int Board::MeasureDistanceToHeadquartersOf(int id, const Point &p) {
   // Measure distance to headquarters of id.
   // Determine the shortest distance as.
@@ -5,8 +5,11 @@
 #ifndef GUNJIN_SHOGI_BOARD_H_
 #define GUNJIN_SHOGI_BOARD_H_
 
+#include <cassert>
+#include <cstdint>
 #include <vector>
 #include "point.h"
+#include "random.h"
 
 class Board {
 public:
@@ -30,6 +33,17 @@ public:
     bool IsMovable() const {
       return (IsPiece() && piece != kFlag && piece != kMine);
     }
+    // Whether all fields are in range, which a piece read from bytes may
+    // not be.
+    bool IsValid() const {
+      bool kind_is_valid = (IsPiece() || piece == kNone ||
+                            piece == kDummyHeadquarters);
+      bool supposition_is_valid = (supposition == kNone ||
+                                   (kTaisho <= supposition &&
+                                    supposition <= kFlag));
+      return (kind_is_valid && supposition_is_valid &&
+              0 <= characters_id && characters_id < kNumPlayers);
+    }
 
     KindPiece piece;
     KindPiece supposition;  // For the ai.
@@ -46,24 +60,129 @@ public:
   static const int kHeight = 8;
   static const int kNumEntrances = 4;
   static const int kNumPlayers = 2;
+  // Capacity of the undo stack. It must cover the longest game plus the
+  // deepest line the ai searches, because nothing is allocated while playing.
+  static const int kMaxNumLogs = 512;
+  // A game over this is adjudicated by the number of pieces. It is the
+  // longest limit too, which leaves the other half of the undo stack for the
+  // ai to search.
+  static const int kDefaultMaxNumPlies = kMaxNumLogs / 2 - 1;
+  // Suppositions kept in a log, since each character supposes once at most
+  // after each move.
+  static const int kMaxNumBeliefs = kNumPlayers;
+  // A game is drawn when the same position appears this many times.
+  static const int kMaxNumRepetitions = 3;
+  // The supposer of a board which knows all pieces.
+  static const int kNoSupposer = -1;
   static const Point kEntrances[kNumEntrances];
   static const Point kHeadquarters[kNumPlayers][2];
   static const int kNumEachPiece[Piece::kNumKindPieces];
   static const BattleResult
       kBattleTable[Piece::kNumKindPieces - 1][Piece::kNumKindPieces - 1];
 
+  // Raw squares, in which dummy headquarters are kept as they are.
+  typedef Piece Squares[kHeight][kWidth];
+
+  Board()
+      : num_logs_(0), hash_(0), supposition_hash_(0),
+        supposer_id_(kNoSupposer) {
+    num_pieces_[0] = num_pieces_[1] = 0;
+  }
+
   void Initialize();
+  // Replaces all squares and forgets the logs.
+  void Load(const Squares &squares);
+  // Whether squares read from bytes can be loaded: all pieces are valid,
+  // dummy headquarters are in place and no kind is more than a character
+  // has.
+  static bool IsLoadable(const Squares &squares);
+  static bool IsInside(const Point &p) {
+    return (0 <= p.y && p.y < kHeight && 0 <= p.x && p.x < kWidth);
+  }
   void Battle(const Move &move);
+  // Moves a piece with the result told by someone who knows all pieces.
+  // "result" is seen from the piece at the source.
+  void ReportBattle(const Move &move, BattleResult result);
   bool IsValid(int characters_id, std::vector<Point> *error) const;
   bool IsMoveValid(const Move &move) const;
+  // Whether the piece at source can move to destination if an opponent's
+  // piece is there, whoever is actually there.
+  bool CanReach(const Move &move) const;
+  // Whether the move is valid if the piece at source is as the supposer
+  // sees it.
+  bool IsSupposedMoveValid(const Move &move) const;
+  // Whether "src_piece" can reach destination from source, whatever is at
+  // source now, so that a move made already can be checked.
+  bool CanReachAs(const Move &move, const Piece &src_piece) const;
+  // Appends all valid moves of "characters_id" seen from the supposer.
+  // A move in or into headquarters is appended once.
+  void GenerateMoves(int characters_id, std::vector<Move> *moves) const;
   bool IsEnd(int *winners_id, bool *game_was_drawn) const;
+  // Ends a game which would never end. Repeated positions are a draw and
+  // a game over "max_num_plies" is won by a character with more pieces.
+  bool IsAdjudicated(int max_num_plies,
+                     int *winners_id, bool *game_was_drawn) const;
+  // Counts previous occurrences of the current position.
+  int CountRepetitions() const;
   bool IsPieceHittingObstacle(const Move &move) const;
-  int CountNumPieces(int characters_id) const;
+  int CountNumPieces(int characters_id) const {
+    return num_pieces_[characters_id];
+  }
   int CountNumPlaceableSquares(const Point &src) const;
   void DeterminePointRandomly(int id, Point *point) const;
   // For the ai. ->
   void SupposeBattle(int supposer_id, const Move &move);
-  int MeasureDistanceToHeadquartersOf(int id, const Point &p);
+  // The result of "SupposeBattle()" seen from the piece at the source.
+  BattleResult SupposeBattleResult(int supposer_id, const Move &move) const;
+  static int MeasureDistanceToHeadquartersOf(int id, const Point &p);
+  // Sets a supposition learned from the previous battle.
+  // It is recorded into the log so that "Undo()" reverts it too. Each
+  // character may suppose once after each move.
+  void Suppose(const Point &p, Piece::KindPiece supposition);
+  // Sets a supposition known before the game, such as one learned from
+  // other games. It is not logged, so "Undo()" never reverts it.
+  void Presume(const Point &p, Piece::KindPiece supposition);
+  // Attack maps are kept up to date by every change of squares,
+  // including "Undo()". Squares are bits of "y * kWidth + x".
+  // They are seen from the supposer, to whom other pieces move as their
+  // suppositions, or as "kChusa" when there are none, so that the ai never
+  // learns kinds hidden from it.
+  void set_supposer_id(int supposer_id) {
+    if (supposer_id == supposer_id_)
+      return;
+    supposer_id_ = supposer_id;
+    Rehash();
+  }
+  // The piece as the supposer sees it.
+  Piece SupposedPieceOf(const Piece &piece) const {
+    Piece supposed = piece;
+    if (supposer_id_ != kNoSupposer && piece.IsPiece() &&
+        piece.characters_id != supposer_id_) {
+      supposed.piece = (piece.supposition != Piece::kNone) ?
+        piece.supposition : Piece::kChusa;
+    }
+    return supposed;
+  }
+  static uint64_t BitOf(const Point &p) {
+    return 1ULL << (p.y * kWidth + p.x);
+  }
+  static Point PointOf(int bit) {
+    Point p = {bit / kWidth, bit % kWidth};
+    return p;
+  }
+  // Squares which the piece on "p" can reach.
+  uint64_t reach(const Point &p) const {
+    return reaches_[p.y][p.x + (IsDummyHeadquarters(p) ? -1 : 0)];
+  }
+  // Squares of pieces of "characters_id" which can reach "p".
+  // Headquarters can be reached through both of its squares.
+  uint64_t attackers(int characters_id, const Point &p) const {
+    Point q = {p.y, p.x + (IsDummyHeadquarters(p) ? -1 : 0)};
+    uint64_t result = attackers_[characters_id][q.y][q.x];
+    if (ExistHeadquartersAt(q))
+      result |= attackers_[characters_id][q.y][q.x + 1];
+    return result;
+  }
   // <- For the ai.
 
   void Swap(const Move &move) {
@@ -77,34 +196,117 @@ public:
     bool x_is_in_range = (point.x == kWidth / 2 - 1);
     return (y_is_in_range && x_is_in_range);
   }
+  // Reverts the previous move exactly, including derived state.
   void Undo() {
-    Log prev = log_.back();
-    log_.pop_back();
+    assert(0 < num_logs_);
+    const Log &prev = logs_[--num_logs_];
+    for (int i = prev.num_beliefs - 1; 0 <= i; --i) {
+      const Belief &kBelief = prev.beliefs[i];
+      Piece piece = board(kBelief.point);
+      piece.supposition = kBelief.prev_supposition;
+      set_board(piece, kBelief.point);
+    }
     set_board(prev.src_piece, prev.move.src);
     set_board(prev.dest_piece, prev.move.dest);
+    hash_ = prev.hash;
+    num_pieces_[0] = prev.num_pieces[0];
+    num_pieces_[1] = prev.num_pieces[1];
   }
   bool IsDummyHeadquarters(const Point &p) const {
     return (board_[p.y][p.x].piece == Piece::kDummyHeadquarters);
   }
 
-  void set_prev_dest(const Piece &piece) { log_.back().dest_piece = piece; }
   void set_board(const Piece &piece, const Point &dest) {
-    board_[dest.y][dest.x + (IsDummyHeadquarters(dest) ? -1 : 0)] = piece;
+    Point p = {dest.y, dest.x + (IsDummyHeadquarters(dest) ? -1 : 0)};
+    Piece &square = board_[p.y][p.x];
+    hash_ ^= HashOf(square, p) ^ HashOf(piece, p);
+    supposition_hash_ ^= SuppositionHashOf(square, p) ^
+                         SuppositionHashOf(piece, p);
+    if (square.IsPiece())
+      --num_pieces_[square.characters_id];
+    if (piece.IsPiece())
+      ++num_pieces_[piece.characters_id];
+
+    // Pieces passing the square are blocked or unblocked,
+    // and they can all reach it.
+    uint64_t changed = 0;
+    if (square.IsPiece() != piece.IsPiece())
+      changed = attackers(0, p) | attackers(1, p) | BitOf(p);
+    else if (square.piece != piece.piece ||
+             square.supposition != piece.supposition ||
+             square.characters_id != piece.characters_id)
+      changed = BitOf(p);
+    RemoveReaches(changed);
+    square = piece;
+    AddReaches(changed);
   }
-  Piece prev_src_piece() const { return log_.back().src_piece; }
-  Piece prev_dest_piece() const { return log_.back().dest_piece; }
-  Move prev_move() const { return log_.back().move; }
-  bool prev_move_is_initialized() const { return !log_.empty(); }
+  Piece prev_src_piece() const { return logs_[num_logs_ - 1].src_piece; }
+  Piece prev_dest_piece() const { return logs_[num_logs_ - 1].dest_piece; }
+  Move prev_move() const { return logs_[num_logs_ - 1].move; }
+  bool prev_move_is_initialized() const { return 0 < num_logs_; }
+  int num_logs() const { return num_logs_; }
+  // Zobrist hash of the kinds and the owners of all pieces.
+  // Suppositions are not included.
+  uint64_t hash() const { return hash_; }
+  // Zobrist hash of the suppositions of all pieces.
+  uint64_t supposition_hash() const { return supposition_hash_; }
+  Random &random() const { return random_; }
+  const Squares &squares() const { return board_; }
   Piece board(const Point &p) const {
     return board_[p.y][p.x + (IsDummyHeadquarters(p) ? -1 : 0)];
   }
 
 private:
+  friend class Snapshot;
+
+  // A supposition before "Suppose()".
+  struct Belief {
+    Point point;
+    Piece::KindPiece prev_supposition;
+  };
+  // Everything needed to revert a move at constant cost.
   struct Log {
     Move move;
     Piece src_piece, dest_piece;
+    uint64_t hash;
+    int num_pieces[kNumPlayers];
+    // Suppositions changed after the move, in order.
+    int num_beliefs;
+    Belief beliefs[kMaxNumBeliefs];
   };
 
+  // Zobrist key of a piece on a square, mixed by splitmix64 from the index
+  // instead of being looked up from a table.
+  static uint64_t HashOf(const Piece &piece, const Point &p) {
+    if (!piece.IsPiece())
+      return 0;
+    uint64_t z = (p.y * kWidth + p.x) * kNumPlayers + piece.characters_id;
+    z = z * Piece::kNumKindPieces + piece.piece + 1;
+    z *= 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  }
+  // A supposition is keyed as a kind, and multiplied apart from it.
+  static uint64_t SuppositionHashOf(const Piece &piece, const Point &p) {
+    if (!piece.IsPiece() || piece.supposition == Piece::kNone)
+      return 0;
+    Piece supposed = piece;
+    supposed.piece = piece.supposition;
+    return HashOf(supposed, p) * 0xff51afd7ed558ccdULL;
+  }
+
+  // Recomputes the hashes, the number of pieces and the attack maps
+  // from scratch.
+  void Rehash();
+  // Removes pieces on "squares" from the attack maps before they change,
+  // and adds them after.
+  void RemoveReaches(uint64_t squares);
+  void AddReaches(uint64_t squares);
+  uint64_t ComputeReach(const Point &p) const;
+  // "src_piece" is taken as the piece at source.
+  bool IsMoveValidAs(const Move &move, const Piece &src_piece) const;
+
   void Delete(const Point &p) {
     Piece deleted_piece;
     deleted_piece.characters_id = p.y / (kHeight / 2);
@@ -113,21 +315,28 @@ private:
     set_board(deleted_piece, p);
   }
 
-  void set_prev_move(const Move &prev_move) {
-    Log prev;
-    prev.move = prev_move;
-    log_.push_back(prev);
-  }
   void add_log(const Move &prev_move) {
-    Log log;
+    assert(num_logs_ < kMaxNumLogs);
+    Log &log = logs_[num_logs_++];
     log.move = prev_move;
     log.src_piece = board(prev_move.src);
     log.dest_piece = board(prev_move.dest);
-    log_.push_back(log);
+    log.hash = hash_;
+    log.num_pieces[0] = num_pieces_[0];
+    log.num_pieces[1] = num_pieces_[1];
+    log.num_beliefs = 0;
   }
 
   Piece board_[kHeight][kWidth];
-  std::vector<Log> log_;
+  Log logs_[kMaxNumLogs];
+  int num_logs_;
+  uint64_t hash_;
+  uint64_t supposition_hash_;
+  int num_pieces_[kNumPlayers];
+  uint64_t reaches_[kHeight][kWidth];
+  uint64_t attackers_[kNumPlayers][kHeight][kWidth];
+  int supposer_id_;
+  mutable Random random_;
 };
 
 #endif  // GUNJIN_SHOGI_BOARD_H_
\ No newline at end of file
@@ -17,6 +17,10 @@ public:
     kPlayer,
     kAi,
   };
+  enum TurnStatus {
+    kWaiting,  // Call again to resume.
+    kDone,
+  };
 
   Character(CharacterType type, Board *board, int id, const std::string &name)
       : type_(type),
@@ -29,6 +33,17 @@ public:
 
   virtual Move MovePiece() = 0;
   virtual void ReplacePieces() = 0;
+  // Resumable versions of above. They return kWaiting instead of blocking
+  // while waiting for input or a search, so that one thread can run
+  // many games. These block by default.
+  virtual TurnStatus ResumeMovePiece(Move *move) {
+    *move = MovePiece();
+    return kDone;
+  }
+  virtual TurnStatus ResumeReplacePieces() {
+    ReplacePieces();
+    return kDone;
+  }
   void UpdateScore() {
     int num_my_pieces = board()->CountNumPieces(id());
     int num_opponents_pieces = board()->CountNumPieces(opponents_id());
@@ -40,6 +55,7 @@ public:
   int opponents_id() const { return kOpponentsId; }
   std::string name() const { return kName; }
   int score() const { return score_; }
+  void set_score(int score) { score_ = score; }
   CharacterType type() const { return type_; }
 
 protected:
@@ -0,0 +1,59 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016 Hirotaka Nagashima. All rights reserved.
+//-----------------------------------------------------------------------------
+// Generates a source file which compiles resources into binaries.
+// Usage: gunjin-embed <output.cc> <resource files...>
+// Resources are named by the file names without directories.
+//-----------------------------------------------------------------------------
+
+#include <cstdio>
+#include <string>
+
+int main(int argc, char *argv[]) {
+  if (argc < 3) {
+    fprintf(stderr, "Usage: %s <output.cc> <resource files...>\n", argv[0]);
+    return -1;
+  }
+  FILE *output = fopen(argv[1], "w");
+  if (!output) {
+    fprintf(stderr, "ERROR: %s can't be written.\n", argv[1]);
+    return -1;
+  }
+
+  fprintf(output, "// Generated by gunjin-embed. Don't edit this file.\n\n");
+  fprintf(output, "#include \"../resources.h\"\n\nnamespace {\n\n");
+
+  // Write the bytes of each file.
+  const int kNumFiles = argc - 2;
+  std::string table;
+  for (int i = 0; i < kNumFiles; ++i) {
+    FILE *file = fopen(argv[i + 2], "rb");
+    if (!file) {
+      fprintf(stderr, "ERROR: %s is not existed.\n", argv[i + 2]);
+      return -1;
+    }
+    fprintf(output, "const unsigned char kData%d[] = {", i);
+    int size = 0, byte;
+    while ((byte = fgetc(file)) != EOF) {
+      fprintf(output, "%s%d,", (size % 20 == 0) ? "\n    " : "", byte);
+      ++size;
+    }
+    fprintf(output, "\n    0};\n\n");
+    fclose(file);
+
+    std::string path = argv[i + 2];
+    std::string name = path.substr(path.find_last_of("/\\") + 1);
+    char entry[256];
+    snprintf(entry, sizeof(entry), "    {\"%s\", kData%d, %d},\n",
+             name.c_str(), i, size);
+    table += entry;
+  }
+
+  // Write the table.
+  fprintf(output, "}  // namespace\n\n");
+  fprintf(output, "extern const Resources::Embedded kEmbeddedResources[] = {\n"
+          "%s};\n", table.c_str());
+  fprintf(output, "extern const int kNumEmbeddedResources = %d;\n", kNumFiles);
+  fclose(output);
+  return 0;
+}
\ No newline at end of file
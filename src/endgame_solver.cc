@@ -0,0 +1,399 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016 Hirotaka Nagashima. All rights reserved.
+//-----------------------------------------------------------------------------
+// Information on this class is described in "endgame_solver.h".
+//-----------------------------------------------------------------------------
+
+#include "endgame_solver.h"
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+
+namespace {
+
+// Distinguishes the character to move in the hash of the board.
+const uint64_t kSideHashKey = 0xd1b54a32d192ed03ULL;
+
+struct CacheHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t padding;
+};
+struct CacheRecord {
+  uint64_t key;
+  int16_t distance;
+  int8_t value;
+  int8_t move[4];
+  int8_t padding;
+};
+
+// Shared by all threads.
+std::mutex cache_mutex;
+std::unordered_map<uint64_t, EndgameSolver::Result> cache;
+bool cache_is_loaded = false;
+
+bool IsHeaderValid(const CacheHeader &header) {
+  return (header.magic == EndgameSolver::kCacheMagic &&
+          header.version == EndgameSolver::kCacheVersion);
+}
+
+void LoadCache() {
+  cache_is_loaded = true;
+  FILE *file = fopen(EndgameSolver::kCacheFileName, "rb");
+  if (!file)
+    return;
+
+  // A broken record is skipped, as it is only a cache.
+  CacheHeader header;
+  CacheRecord record;
+  if (fread(&header, sizeof(header), 1, file) == 1 && IsHeaderValid(header)) {
+    while (fread(&record, sizeof(record), 1, file) == 1) {
+      EndgameSolver::Result result;
+      result.value = static_cast<EndgameSolver::Value>(record.value);
+      result.distance = record.distance;
+      result.move = {{record.move[0], record.move[1]},
+                     {record.move[2], record.move[3]}};
+      if (record.value < EndgameSolver::kUnknown ||
+          EndgameSolver::kDraw < record.value || record.distance < 0 ||
+          !Board::IsInside(result.move.src) ||
+          !Board::IsInside(result.move.dest)) {
+        continue;
+      }
+      cache[record.key] = result;
+    }
+  }
+  fclose(file);
+}
+
+}  // namespace
+
+const char *EndgameSolver::kCacheFileName = "endgames.bin";
+thread_local int EndgameSolver::num_nodes_ = 0;
+
+bool EndgameSolver::IsSolvable(const Board &board) {
+  if (kMaxNumPieces < board.CountNumPieces(0) + board.CountNumPieces(1))
+    return false;
+
+  int num_movable_pieces = 0;
+  Point p;
+  for (p.y = 0; p.y < Board::kHeight; ++p.y) {
+    for (p.x = 0; p.x < Board::kWidth; ++p.x) {
+      if (board.squares()[p.y][p.x].IsMovable())
+        ++num_movable_pieces;
+    }
+  }
+
+  return (num_movable_pieces <= kMaxNumMovablePieces);
+}
+
+bool EndgameSolver::Solve(const Board &board, int characters_id,
+                          int max_milliseconds, Result *result,
+                          const std::atomic<bool> *is_stopped) {
+  num_nodes_ = 0;
+  if (!IsSolvable(board))
+    return false;
+  if (FindCache(KeyOf(board, characters_id), result))
+    return true;
+
+  typedef std::chrono::steady_clock Clock;
+  Clock::time_point deadline = (max_milliseconds == 0) ?
+    Clock::time_point::max() :
+    Clock::now() + std::chrono::milliseconds(max_milliseconds);
+
+  // The solver has a board, which is too large for the stack of workers.
+  std::unique_ptr<EndgameSolver> solver(
+      new EndgameSolver(board, characters_id, is_stopped));
+  bool is_explored = solver->Explore(deadline);
+  num_nodes_ = static_cast<int>(solver->nodes_.size());
+  if (!is_explored)
+    return false;
+
+  if (!solver->Retrograde(deadline))
+    return false;
+  *result = solver->ResultOf(0);
+  solver->CacheResults(deadline);
+  return true;
+}
+
+EndgameSolver::EndgameSolver(const Board &board, int characters_id,
+                             const std::atomic<bool> *is_stopped)
+    : is_stopped_(is_stopped) {
+  memcpy(empty_squares_, board.squares(), sizeof(empty_squares_));
+  Point p;
+  for (p.y = 0; p.y < Board::kHeight; ++p.y) {
+    for (p.x = 0; p.x < Board::kWidth; ++p.x) {
+      Board::Piece &square = empty_squares_[p.y][p.x];
+      if (!square.IsPiece())
+        continue;
+      square.piece = Board::Piece::kNone;
+      square.supposition = Board::Piece::kNone;
+      square.characters_id = p.y / (Board::kHeight / 2);
+    }
+  }
+
+  AddNode(board, characters_id);
+}
+
+uint64_t EndgameSolver::KeyOf(const Board &board, int characters_id) {
+  return board.hash() ^ ((characters_id == 0) ? 0 : kSideHashKey);
+}
+
+bool EndgameSolver::FindCache(uint64_t key, Result *result) {
+  std::lock_guard<std::mutex> lock(cache_mutex);
+  if (!cache_is_loaded)
+    LoadCache();
+
+  std::unordered_map<uint64_t, Result>::const_iterator it = cache.find(key);
+  if (it == cache.end())
+    return false;
+  *result = it->second;
+  return true;
+}
+
+void EndgameSolver::AddCache(
+    const std::vector<std::pair<uint64_t, Result> > &results) {
+  std::lock_guard<std::mutex> lock(cache_mutex);
+  if (!cache_is_loaded)
+    LoadCache();
+
+  // Append only new positions. The cache works without the file.
+  std::vector<CacheRecord> records;
+  for (int i = 0; i < static_cast<int>(results.size()); ++i) {
+    if (!cache.insert(results[i]).second)
+      continue;
+
+    const Result &kResult = results[i].second;
+    CacheRecord record;
+    memset(&record, 0, sizeof(record));
+    record.key = results[i].first;
+    record.distance = static_cast<int16_t>(kResult.distance);
+    record.value = static_cast<int8_t>(kResult.value);
+    record.move[0] = static_cast<int8_t>(kResult.move.src.y);
+    record.move[1] = static_cast<int8_t>(kResult.move.src.x);
+    record.move[2] = static_cast<int8_t>(kResult.move.dest.y);
+    record.move[3] = static_cast<int8_t>(kResult.move.dest.x);
+    records.push_back(record);
+  }
+  if (records.empty())
+    return;
+  int fd = open(kCacheFileName, O_RDWR | O_CREAT, 0644);
+  if (fd < 0)
+    return;
+
+  // Writers of all processes take turns. A file without a whole header
+  // starts again, and a broken record at the end is overwritten.
+  flock(fd, LOCK_EX);
+  struct stat status;
+  size_t size = (fstat(fd, &status) == 0) ?
+    static_cast<size_t>(status.st_size) : 0;
+  CacheHeader header = {kCacheMagic, kCacheVersion, 0};
+  bool is_writable = (size < sizeof(header)) ?
+    (pwrite(fd, &header, sizeof(header), 0) ==
+     static_cast<ssize_t>(sizeof(header))) :
+    (pread(fd, &header, sizeof(header), 0) ==
+     static_cast<ssize_t>(sizeof(header)) && IsHeaderValid(header));
+  if (is_writable) {
+    size_t num_records = (size < sizeof(header)) ? 0 :
+      (size - sizeof(header)) / sizeof(CacheRecord);
+    size_t offset = sizeof(header) + num_records * sizeof(CacheRecord);
+    size_t num_bytes = records.size() * sizeof(CacheRecord);
+    if (pwrite(fd, &records[0], num_bytes, offset) !=
+        static_cast<ssize_t>(num_bytes)) {
+      perror("ERROR");
+    }
+  }
+  flock(fd, LOCK_UN);
+  close(fd);
+}
+
+bool EndgameSolver::IsSolveEnd(
+    std::chrono::steady_clock::time_point deadline) const {
+  return ((is_stopped_ && *is_stopped_) ||
+          deadline < std::chrono::steady_clock::now());
+}
+
+bool EndgameSolver::Explore(std::chrono::steady_clock::time_point deadline) {
+  for (int i = 0; i < static_cast<int>(nodes_.size()); ++i) {
+    if ((i & 0xff) == 0 && IsSolveEnd(deadline))
+      return false;
+
+    Load(nodes_[i]);
+    int characters_id = nodes_[i].characters_id;
+    int winners_id = 0;
+    bool game_was_drawn = false;
+    if (board_.IsEnd(&winners_id, &game_was_drawn)) {
+      nodes_[i].value = game_was_drawn ? kDraw :
+        (winners_id == characters_id) ? kWin : kLoss;
+      continue;
+    }
+
+    // A character who cannot move loses.
+    moves_.clear();
+    board_.GenerateMoves(characters_id, &moves_);
+    if (moves_.empty()) {
+      nodes_[i].value = kLoss;
+      continue;
+    }
+
+    nodes_[i].first_child = static_cast<int>(children_.size());
+    nodes_[i].num_children = static_cast<int>(moves_.size());
+    for (int j = 0; j < static_cast<int>(moves_.size()); ++j) {
+      board_.Battle(moves_[j]);
+      uint64_t key = KeyOf(board_, 1 - characters_id);
+      std::unordered_map<uint64_t, int>::const_iterator it =
+        node_ids_.find(key);
+      if (it != node_ids_.end()) {
+        children_.push_back(it->second);
+      } else {
+        if (kMaxNumNodes <= static_cast<int>(nodes_.size()))
+          return false;
+        children_.push_back(static_cast<int>(nodes_.size()));
+        AddNode(board_, 1 - characters_id);
+      }
+      board_.Undo();
+    }
+  }
+
+  return true;
+}
+
+bool EndgameSolver::Retrograde(
+    std::chrono::steady_clock::time_point deadline) {
+  std::vector<int> unknowns;
+  for (int i = 0; i < static_cast<int>(nodes_.size()); ++i) {
+    if (nodes_[i].value == kUnknown)
+      unknowns.push_back(i);
+  }
+
+  // Positions found in the n-th pass end in n plies, because values of
+  // a pass are applied after it.
+  std::vector<std::pair<int, Value> > resolved;
+  for (int distance = 1; !unknowns.empty(); ++distance) {
+    if (IsSolveEnd(deadline))
+      return false;
+    resolved.clear();
+    int num_unknowns = 0;
+    for (int i = 0; i < static_cast<int>(unknowns.size()); ++i) {
+      const Node &kNode = nodes_[unknowns[i]];
+      bool is_won = false;
+      bool is_lost = true;
+      for (int j = 0; j < kNode.num_children && !is_won; ++j) {
+        int value = nodes_[children_[kNode.first_child + j]].value;
+        is_won = (value == kLoss);
+        is_lost = is_lost && (value == kWin);
+      }
+      if (is_won || is_lost)
+        resolved.push_back(std::make_pair(unknowns[i], is_won ? kWin : kLoss));
+      else
+        unknowns[num_unknowns++] = unknowns[i];
+    }
+    if (resolved.empty())
+      break;
+
+    unknowns.resize(num_unknowns);
+    for (int i = 0; i < static_cast<int>(resolved.size()); ++i) {
+      nodes_[resolved[i].first].value = resolved[i].second;
+      nodes_[resolved[i].first].distance = static_cast<int16_t>(distance);
+    }
+  }
+
+  // The rest are never forced to end.
+  for (int i = 0; i < static_cast<int>(unknowns.size()); ++i)
+    nodes_[unknowns[i]].value = kDraw;
+  return true;
+}
+
+void EndgameSolver::Load(const Node &node) {
+  Board::Squares squares;
+  memcpy(squares, empty_squares_, sizeof(squares));
+  for (int i = 0; i < node.num_pieces; ++i) {
+    Point p = Board::PointOf(node.squares[i]);
+    Board::Piece &square = squares[p.y][p.x];
+    square.piece = static_cast<Board::Piece::KindPiece>(node.kinds[i]);
+    square.characters_id = node.characters_ids[i];
+  }
+  board_.Load(squares);
+}
+
+void EndgameSolver::AddNode(const Board &board, int characters_id) {
+  Node node;
+  memset(&node, 0, sizeof(node));
+  node.key = KeyOf(board, characters_id);
+  node.characters_id = static_cast<int8_t>(characters_id);
+  node.value = kUnknown;
+  node.best_child = -1;
+  Point p;
+  for (p.y = 0; p.y < Board::kHeight; ++p.y) {
+    for (p.x = 0; p.x < Board::kWidth; ++p.x) {
+      Board::Piece piece = board.squares()[p.y][p.x];
+      if (!piece.IsPiece())
+        continue;
+      node.squares[node.num_pieces] =
+        static_cast<uint8_t>(p.y * Board::kWidth + p.x);
+      node.kinds[node.num_pieces] = static_cast<int8_t>(piece.piece);
+      node.characters_ids[node.num_pieces] =
+        static_cast<int8_t>(piece.characters_id);
+      ++node.num_pieces;
+    }
+  }
+
+  node_ids_[node.key] = static_cast<int>(nodes_.size());
+  nodes_.push_back(node);
+}
+
+EndgameSolver::Result EndgameSolver::ResultOf(int node_id) {
+  Node &node = nodes_[node_id];
+  Result result = {static_cast<Value>(node.value), node.distance, {}};
+  if (node.num_children == 0)
+    return result;
+
+  // Win fastest, lose slowest and keep a draw.
+  int best_distance = 0;
+  for (int i = 0; i < node.num_children; ++i) {
+    const Node &kChild = nodes_[children_[node.first_child + i]];
+    bool is_better = false;
+    switch (node.value) {
+    case kWin:
+      is_better = (kChild.value == kLoss &&
+                   (node.best_child < 0 || kChild.distance < best_distance));
+      break;
+    case kLoss:
+      is_better = (node.best_child < 0 || best_distance < kChild.distance);
+      break;
+    default:
+      is_better = (kChild.value == kDraw && node.best_child < 0);
+      break;
+    }
+    if (is_better) {
+      node.best_child = i;
+      best_distance = kChild.distance;
+    }
+  }
+
+  // Moves are generated in the same order as exploring.
+  Load(node);
+  moves_.clear();
+  board_.GenerateMoves(node.characters_id, &moves_);
+  result.move = moves_[node.best_child];
+  return result;
+}
+
+void EndgameSolver::CacheResults(
+    std::chrono::steady_clock::time_point deadline) {
+  // Only positions of the character to move at the root are faced again.
+  std::vector<std::pair<uint64_t, Result> > results;
+  for (int i = 0; i < static_cast<int>(nodes_.size()); ++i) {
+    if ((i & 0xff) == 0xff && IsSolveEnd(deadline))
+      break;
+    if (nodes_[i].characters_id == nodes_[0].characters_id &&
+        0 < nodes_[i].num_children) {
+      results.push_back(std::make_pair(nodes_[i].key, ResultOf(i)));
+    }
+  }
+  AddCache(results);
+}
\ No newline at end of file
@@ -0,0 +1,116 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016 Hirotaka Nagashima. All rights reserved.
+//-----------------------------------------------------------------------------
+// This class proves the result of an endgame whose pieces are all known.
+// All positions reachable from the board are enumerated into its own hash
+// table, and they are solved backward from the ends of the game
+// (retrograde analysis). A position which is neither won nor lost is a
+// draw, because the game goes round forever. Games adjudicated by the
+// number of plies are not taken into account.
+//
+// Solved positions of the character to move are cached, and appended to
+// "kCacheFileName" to be reused across games and processes. The file is
+//   magic(4) version(2) padding(2)
+// and records of
+//   key(8) distance(2) value(1) move(4) padding(1)
+// with integers in the native order. Writers of all processes take turns
+// with a lock of the file. A file of another version is neither read nor
+// written, since keys change with the hash of boards.
+//-----------------------------------------------------------------------------
+
+#ifndef GUNJIN_SHOGI_ENDGAME_SOLVER_H_
+#define GUNJIN_SHOGI_ENDGAME_SOLVER_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "board.h"
+#include "point.h"
+
+class EndgameSolver {
+public:
+  // For the character to move.
+  enum Value {
+    kUnknown,
+    kWin,
+    kLoss,
+    kDraw,
+  };
+  struct Result {
+    Value value;
+    // Plies to the end of the game with the best play of both.
+    int distance;
+    Move move;
+  };
+
+  // Flags and mines stay where they are, so they hardly add positions.
+  static const int kMaxNumPieces = 8;
+  static const int kMaxNumMovablePieces = 3;
+  static const int kMaxNumNodes = 1 << 17;
+  static const char *kCacheFileName;
+  static const uint32_t kCacheMagic = 0x47454a47;  // "GJEG"
+  static const uint16_t kCacheVersion = 1;
+
+  // Whether "board" has pieces few enough to be solved.
+  static bool IsSolvable(const Board &board);
+  // Solves "board" with "characters_id" to move. The kinds of all pieces
+  // are taken as true. Returns false if there are more positions than
+  // "kMaxNumNodes", "max_milliseconds" passes or "is_stopped" is set by
+  // another thread. Zero means unlimited. Positions left to cache at the
+  // time are dropped.
+  static bool Solve(const Board &board, int characters_id,
+                    int max_milliseconds, Result *result,
+                    const std::atomic<bool> *is_stopped = nullptr);
+  // Positions explored by the last "Solve()" of this thread.
+  static int num_nodes() { return num_nodes_; }
+
+private:
+  struct Node {
+    uint64_t key;
+    // Pieces as "Board::BitOf()", kind and owner.
+    uint8_t squares[kMaxNumPieces];
+    int8_t kinds[kMaxNumPieces];
+    int8_t characters_ids[kMaxNumPieces];
+    int8_t num_pieces;
+    int8_t characters_id;
+    int8_t value;
+    int16_t distance;
+    int first_child;
+    int num_children;
+    // Index of the best move among "Board::GenerateMoves()".
+    int best_child;
+  };
+
+  EndgameSolver(const Board &board, int characters_id,
+                const std::atomic<bool> *is_stopped);
+
+  static uint64_t KeyOf(const Board &board, int characters_id);
+  // The cache is loaded from the file at the first access.
+  static bool FindCache(uint64_t key, Result *result);
+  static void AddCache(const std::vector<std::pair<uint64_t, Result> > &
+                       results);
+
+  bool IsSolveEnd(std::chrono::steady_clock::time_point deadline) const;
+  bool Explore(std::chrono::steady_clock::time_point deadline);
+  bool Retrograde(std::chrono::steady_clock::time_point deadline);
+  // Restores the position of "node" into "board_".
+  void Load(const Node &node);
+  void AddNode(const Board &board, int characters_id);
+  Result ResultOf(int node_id);
+  void CacheResults(std::chrono::steady_clock::time_point deadline);
+
+  static thread_local int num_nodes_;
+
+  // Squares without pieces, where dummy headquarters are kept.
+  Board::Squares empty_squares_;
+  const std::atomic<bool> *is_stopped_;
+  Board board_;
+  std::vector<Node> nodes_;
+  std::vector<int> children_;
+  std::unordered_map<uint64_t, int> node_ids_;
+  std::vector<Move> moves_;
+};
+
+#endif  // GUNJIN_SHOGI_ENDGAME_SOLVER_H_
\ No newline at end of file
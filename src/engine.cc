@@ -0,0 +1,300 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016 Hirotaka Nagashima. All rights reserved.
+//-----------------------------------------------------------------------------
+// Information on this class is described in "engine.h".
+//-----------------------------------------------------------------------------
+
+#include "engine.h"
+#include <cstring>
+#include <vector>
+#include "ai.h"
+#include "point.h"
+
+namespace {
+
+// Indexed by "EndgameSolver::Value".
+const char *const kEndgameValueNames[] = {"none", "win", "loss", "draw"};
+
+// Returns false if "name" is not a limit or its value is wrong.
+bool ParseLimit(const std::string &name, std::istringstream *args,
+                Ai::SearchLimits *limits) {
+  int *value = nullptr;
+  if (name == "nodes") {
+    value = &limits->max_num_nodes;
+  } else if (name == "movetime") {
+    value = &limits->max_milliseconds;
+  } else if (name == "depth") {
+    value = &limits->max_depth;
+  } else if (name == "level") {
+    std::string level_name;
+    Ai::Level level;
+    *args >> level_name;
+    if (!Ai::ParseLevel(level_name, &level))
+      return false;
+    *limits = Ai::LimitsOf(level);
+  } else {
+    return false;
+  }
+  return (!value || (*args >> *value && 0 <= *value));
+}
+
+}  // namespace
+
+Engine::~Engine() {
+  if (ai_)
+    ai_->Stop();
+  if (analyst_)
+    analyst_->Stop();
+  WaitSearch();
+  delete ai_;
+  delete analyst_;
+}
+
+void Engine::Run(std::istream &in, std::ostream &out) {
+  out_ = &out;
+  std::string line;
+  while (std::getline(in, line)) {
+    if (!Execute(line))
+      break;
+  }
+
+  // Stop a running search.
+  if (ai_)
+    ai_->Stop();
+  if (analyst_)
+    analyst_->Stop();
+  WaitSearch();
+}
+
+bool Engine::Execute(const std::string &line) {
+  std::istringstream args(line);
+  std::string command;
+  if (!(args >> command))
+    return true;
+
+  // Commands below are available while searching.
+  if (command == "quit") {
+    return false;
+  } else if (command == "stop") {
+    if (ai_)
+      ai_->Stop();
+    if (analyst_)
+      analyst_->Stop();
+    return true;
+  } else if (command == "isready") {
+    Print("readyok");
+    return true;
+  }
+
+  // Commands below wait for a running search.
+  WaitSearch();
+  if (command == "gsei") {
+    Print("id name Gunjin Shogi");
+    Print("gseiok");
+  } else if (command == "newgame") {
+    NewGame(&args);
+  } else if (!ai_) {
+    Print("error no game");
+  } else if (command == "formation") {
+    SetFormation(&args);
+  } else if (command == "move") {
+    ApplyMove(&args);
+  } else if (command == "go") {
+    Go(&args);
+  } else if (command == "analyze") {
+    Analyze(&args);
+  } else {
+    Print("error unknown command " + command);
+  }
+
+  return true;
+}
+
+void Engine::NewGame(std::istringstream *args) {
+  int id;
+  if (!(*args >> id) || id < 0 || Board::kNumPlayers <= id) {
+    Print("error wrong id");
+    return;
+  }
+
+  // Place pieces of both characters, then the ai replaces its own.
+  board_.random().Seed(random_.Next());
+  board_.Initialize();
+  delete ai_;
+  ai_ = new Ai(&board_, id, "Engine");
+  ai_->ReplacePieces();
+  PrintFormation();
+}
+
+void Engine::SetFormation(std::istringstream *args) {
+  std::vector<int> formation;
+  int kind_piece;
+  while (*args >> kind_piece)
+    formation.push_back(kind_piece);
+
+  // Place the formation and check it. A formation against the rules is
+  // taken back.
+  Board::Squares squares;
+  memcpy(squares, board_.squares(), sizeof(squares));
+  std::vector<Point> error;
+  if (!ai_->PlaceFormation(formation) ||
+      !board_.IsValid(ai_->id(), &error)) {
+    board_.Load(squares);
+    Print("error wrong formation");
+    return;
+  }
+  PrintFormation();
+}
+
+void Engine::ApplyMove(std::istringstream *args) {
+  Move move;
+  std::string result;
+  if (!(*args >> move.src.y >> move.src.x >> move.dest.y >> move.dest.x >>
+        result)) {
+    Print("error wrong move");
+    return;
+  }
+
+  // Check the move roughly since kinds of opponent's pieces are unknown.
+  bool is_in_board = true;
+  const Point kPoints[] = {move.src, move.dest};
+  for (int i = 0; i < 2; ++i) {
+    is_in_board &= (0 <= kPoints[i].y && kPoints[i].y < Board::kHeight &&
+                    0 <= kPoints[i].x && kPoints[i].x < Board::kWidth);
+  }
+  if (!is_in_board || !board_.board(move.src).IsPiece() ||
+      (board_.board(move.src).characters_id == ai_->id() &&
+       !board_.IsMoveValid(move))) {
+    Print("error wrong move");
+    return;
+  }
+
+  // Move the piece with the result.
+  Board::BattleResult battle_result;
+  if (result == "w") {
+    battle_result = Board::kW;
+  } else if (result == "l") {
+    battle_result = Board::kL;
+  } else if (result == "d") {
+    battle_result = Board::kD;
+  } else {
+    Print("error wrong result");
+    return;
+  }
+  board_.ReportBattle(move, battle_result);
+  ai_->Observe();
+}
+
+void Engine::Go(std::istringstream *args) {
+  Ai::SearchLimits limits = {0, 0, 0};
+  std::string name;
+  while (*args >> name) {
+    if (!ParseLimit(name, args, &limits)) {
+      Print("error wrong limit " + name);
+      return;
+    }
+  }
+
+  // Search in the background to accept "stop", which may come before the
+  // thread starts.
+  ai_->ClearStop();
+  search_thread_ = std::thread([this, limits]() {
+    Ai::SearchInfo info;
+    Move best_move = ai_->Search(limits, &info);
+
+    std::ostringstream result;
+    result << "info nodes " << info.num_nodes << " time " <<
+        info.milliseconds << " score " << info.evaluation_value <<
+        " qnodes " << info.num_quiescence_nodes << " seldepth " <<
+        info.max_quiescence_depth << " standpats " << info.num_stand_pats <<
+        " deltaprunes " << info.num_delta_prunes << " depth " <<
+        info.depth << " cutoffs " << info.num_cutoffs << " firstcutoffs " <<
+        info.num_first_move_cutoffs << " evals " << info.num_evaluations <<
+        " evalhits " << info.num_evaluation_hits << " endgame " <<
+        kEndgameValueNames[info.endgame_value] << "\n";
+    // An endgame found in the cache is played without any node.
+    if (!board_.IsMoveValid(best_move)) {
+      result << "bestmove none";
+    } else {
+      result << "bestmove " << best_move.src.y << " " << best_move.src.x <<
+          " " << best_move.dest.y << " " << best_move.dest.x;
+    }
+    Print(result.str());
+  });
+}
+
+void Engine::Analyze(std::istringstream *args) {
+  Ai::SearchLimits limits = {0, 0, 0};
+  int num_lines = 1;
+  std::string name;
+  while (*args >> name) {
+    if (name == "lines") {
+      if (!(*args >> num_lines) || num_lines <= 0) {
+        Print("error wrong lines");
+        return;
+      }
+    } else if (!ParseLimit(name, args, &limits)) {
+      Print("error wrong limit " + name);
+      return;
+    }
+  }
+
+  // A new ai keeps "stop" which comes before it starts.
+  delete analyst_;
+  analyst_ = new Ai(&board_, ai_->id(), "Analyst");
+  search_thread_ = std::thread([this, limits, num_lines]() {
+    Move best_move = {};
+    bool has_best_move = false;
+    analyst_->Analyze(limits, num_lines,
+                      [this, &best_move, &has_best_move](
+                          const Ai::Analysis &analysis) {
+      std::ostringstream result;
+      for (int i = 0; i < static_cast<int>(analysis.lines.size()); ++i) {
+        const Ai::Line &kLine = analysis.lines[i];
+        result << ((i == 0) ? "" : "\n") << "info depth " <<
+            analysis.depth << " line " << i + 1 << " score " <<
+            kLine.evaluation_value << " nodes " << analysis.num_nodes <<
+            " time " << analysis.milliseconds << " pv";
+        for (const Move &kMove : kLine.principal_variation) {
+          result << " " << kMove.src.y << " " << kMove.src.x << " " <<
+              kMove.dest.y << " " << kMove.dest.x;
+        }
+      }
+      Print(result.str());
+      best_move = analysis.lines[0].move;
+      has_best_move = true;
+    });
+
+    if (!has_best_move) {
+      Print("bestmove none");
+    } else {
+      std::ostringstream result;
+      result << "bestmove " << best_move.src.y << " " << best_move.src.x <<
+          " " << best_move.dest.y << " " << best_move.dest.x;
+      Print(result.str());
+    }
+  });
+}
+
+void Engine::WaitSearch() {
+  if (search_thread_.joinable())
+    search_thread_.join();
+}
+
+void Engine::PrintFormation() {
+  std::ostringstream formation;
+  formation << "formation";
+  for (int y = 0; y < Board::kHeight / 2; ++y) {
+    for (int x = 0; x < Board::kWidth; ++x) {
+      Point p = {(ai_->id() == 0) ? y : Board::kHeight - 1 - y,
+        (ai_->id() == 0) ? x : Board::kWidth - 1 - x};
+      formation << " " << board_.board(p).piece;
+    }
+  }
+  Print(formation.str());
+}
+
+void Engine::Print(const std::string &text) {
+  std::lock_guard<std::mutex> lock(out_mutex_);
+  *out_ << text << std::endl;
+}
\ No newline at end of file
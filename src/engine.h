@@ -0,0 +1,98 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016 Hirotaka Nagashima. All rights reserved.
+//-----------------------------------------------------------------------------
+// This class runs the ai as an engine which talks a text protocol,
+// so that the ai can be driven by other programs without a window.
+//
+// Commands (a board is seen as in "Board", and a move is "sy sx dy dx"):
+//   gsei                    -> "id name <name>", "gseiok"
+//   isready                 -> "readyok"
+//   newgame <id>            -> "formation <kinds>"
+//     Starts a game as the character <id> with a formation of the book.
+//   formation <kinds>       -> "formation <kinds>"
+//     Places 24 kinds of pieces from the back row of the engine. Both
+//     squares of headquarters have the same kind.
+//   move <move> <w|l|d>
+//     Moves a piece of either character with the result of the battle
+//     seen from the moved piece.
+//   go [level <name>] [nodes <n>] [movetime <ms>] [depth <n>]
+//                           -> "info nodes <n> time <ms> score <value>
+//                                    qnodes <n> seldepth <n> standpats <n>
+//                                    deltaprunes <n> depth <n> cutoffs <n>
+//                                    firstcutoffs <n> evals <n> evalhits <n>
+//                                    endgame <none|win|loss|draw>",
+//                              "bestmove <move>" or "bestmove none"
+//     Searches in the background. The move is not made till "move".
+//     "q" statistics are of the extension over battles after each move.
+//     "depth" is of the last iteration finished, and firstcutoffs over
+//     cutoffs tells how well moves are ordered. evalhits over evals is the
+//     hit rate of the cache of evaluations. "endgame" is proven by
+//     the endgame solver, which plays the move unless it is lost.
+//     "level" is one of beginner, easy, normal and hard, and sets all
+//     limits, which the limits after it override. "movetime" is never
+//     exceeded.
+//   analyze [lines <k>] [level <name>] [nodes <n>] [movetime <ms>]
+//           [depth <n>]
+//                           -> "info depth <n> line <i> score <value>
+//                                    nodes <n> time <ms> pv <moves>" * k,
+//                              "bestmove <move>" or "bestmove none"
+//     Searches the best k moves deeper and deeper in the background till
+//     the limits or "stop", and prints them after each depth. The depth
+//     is unlimited by default.
+//   stop                    Makes a running search return immediately.
+//   quit
+// A wrong command is answered with "error <message>".
+//-----------------------------------------------------------------------------
+
+#ifndef GUNJIN_SHOGI_ENGINE_H_
+#define GUNJIN_SHOGI_ENGINE_H_
+
+#include <ctime>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include "board.h"
+#include "random.h"
+
+class Ai;
+class Engine {
+public:
+  Engine() : ai_(nullptr), analyst_(nullptr), out_(nullptr) {
+    // Reset random seed randomly.
+    random_.Seed(static_cast<uint64_t>(time(NULL)));
+  }
+  ~Engine();
+
+  // Reads commands till "quit" or the end of the input.
+  void Run(std::istream &in, std::ostream &out);
+
+private:
+  // Returns false if the engine should quit.
+  bool Execute(const std::string &line);
+  void NewGame(std::istringstream *args);
+  void SetFormation(std::istringstream *args);
+  void ApplyMove(std::istringstream *args);
+  void Go(std::istringstream *args);
+  void Analyze(std::istringstream *args);
+  void WaitSearch();
+  void PrintFormation();
+  // Thread-safe.
+  void Print(const std::string &text);
+
+  // Identities of the opponent's pieces are unknown to the engine,
+  // so they are left as they are placed randomly. The ai only uses
+  // suppositions of them.
+  Board board_;
+  Ai *ai_;
+  // Of the last "analyze".
+  Ai *analyst_;
+  // Seeds of games.
+  Random random_;
+  std::thread search_thread_;
+  std::mutex out_mutex_;
+  std::ostream *out_;
+};
+
+#endif  // GUNJIN_SHOGI_ENGINE_H_
\ No newline at end of file
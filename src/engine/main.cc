@@ -0,0 +1,15 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016 Hirotaka Nagashima. All rights reserved.
+//-----------------------------------------------------------------------------
+// The engine process. The protocol is described in "engine.h".
+//-----------------------------------------------------------------------------
+
+#include <iostream>
+#include "../engine.h"
+
+int main() {
+  std::ios::sync_with_stdio(false);
+  Engine engine;
+  engine.Run(std::cin, std::cout);
+  return 0;
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016 Hirotaka Nagashima. All rights reserved.
+//-----------------------------------------------------------------------------
+// Information on this class is described in "feed.h".
+//-----------------------------------------------------------------------------
+
+#include "feed.h"
+#include <cstdio>
+#include "point.h"
+
+const char Feed::kSquares[] =
+    "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmn";
+
+void Feed::Update(const Board &board) {
+  bool is_synced = (!is_started_ || board.num_logs() % kSyncInterval == 0);
+  is_started_ = true;
+  ply_ = board.num_logs();
+
+  for (int i = 0; i < kNumPerspectives; ++i) {
+    Perspective perspective = static_cast<Perspective>(i);
+    std::string &view = views_[i];
+    std::string &message = messages_[i];
+    view.resize(Board::kHeight * Board::kWidth, '.');
+
+    // Compare all squares, since a headquarters is 2 squares.
+    char head[32];
+    snprintf(head, sizeof(head), "view %d ", ply_);
+    message = head;
+    Point p;
+    for (p.y = 0; p.y < Board::kHeight; ++p.y) {
+      for (p.x = 0; p.x < Board::kWidth; ++p.x) {
+        int index = p.y * Board::kWidth + p.x;
+        char letter = ToLetter(board.board(p), perspective);
+        if (view[index] != letter) {
+          view[index] = letter;
+          message += kSquares[index];
+          message += letter;
+        }
+      }
+    }
+
+    if (is_synced)
+      message = Sync(perspective);
+  }
+}
+
+std::string Feed::Sync(Perspective perspective) const {
+  char head[32];
+  snprintf(head, sizeof(head), "sync %d ", ply_);
+  return head + views_[perspective];
+}
+
+char Feed::ToLetter(const Board::Piece &piece, Perspective perspective) {
+  if (!piece.IsPiece())
+    return '.';
+  if (piece.characters_id != perspective)
+    return (piece.characters_id == 0) ? 'X' : 'x';
+  return static_cast<char>(((piece.characters_id == 0) ? 'A' : 'a') +
+                           piece.piece);
+}
\ No newline at end of file
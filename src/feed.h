@@ -0,0 +1,60 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016 Hirotaka Nagashima. All rights reserved.
+//-----------------------------------------------------------------------------
+// This class makes messages for spectators of a game.
+// A board is seen from a perspective as "Graphic" draws it: kinds of
+// pieces of the other character are hidden, and owners are shown.
+//
+// A square is a letter. "." is empty, "A" to "P" are kinds of pieces
+// of the character 0 and "a" to "p" are of the character 1.
+// "X" and "x" are hidden pieces of them.
+//   sync <ply> <squares>
+//     All 48 squares, which are made every "kSyncInterval" plies.
+//   view <ply> <changes>
+//     Changed squares after a battle. A change is 2 letters:
+//     "kSquares[y * Board::kWidth + x]" and the square.
+//-----------------------------------------------------------------------------
+
+#ifndef GUNJIN_SHOGI_FEED_H_
+#define GUNJIN_SHOGI_FEED_H_
+
+#include <string>
+#include "board.h"
+
+class Feed {
+public:
+  enum Perspective {
+    kCharacter0,
+    kCharacter1,
+    // Both characters are hidden.
+    kPublic,
+    kNumPerspectives,
+  };
+
+  static const int kSyncInterval = 16;
+  static const char kSquares[];
+
+  Feed() : ply_(0), is_started_(false) {}
+
+  // Makes a message for each perspective after a battle.
+  void Update(const Board &board);
+  // All squares for a spectator who joins now.
+  std::string Sync(Perspective perspective) const;
+
+  // The message made by the last "Update()".
+  const std::string &message(Perspective perspective) const {
+    return messages_[perspective];
+  }
+  bool is_started() const { return is_started_; }
+
+private:
+  static char ToLetter(const Board::Piece &piece, Perspective perspective);
+
+  // A letter for each square.
+  std::string views_[kNumPerspectives];
+  std::string messages_[kNumPerspectives];
+  int ply_;
+  bool is_started_;
+};
+
+#endif  // GUNJIN_SHOGI_FEED_H_
\ No newline at end of file
@@ -0,0 +1,151 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016 Hirotaka Nagashima. All rights reserved.
+//-----------------------------------------------------------------------------
+// Information on this class is described in "formation_stats.h".
+//-----------------------------------------------------------------------------
+
+#include "formation_stats.h"
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstring>
+#include <mutex>
+
+namespace {
+
+// The file mapped for readers, which is shared by all threads and mapped
+// again when the file grows.
+std::mutex mapping_mutex;
+void *mapping = nullptr;
+size_t mapping_size = 0;
+
+// Returns 0 if the size is unknown.
+size_t SizeOf(int fd) {
+  struct stat status;
+  return (fstat(fd, &status) == 0) ? static_cast<size_t>(status.st_size) : 0;
+}
+
+}  // namespace
+
+const char *FormationStats::kFileName = "opponents.bin";
+
+bool FormationStats::Find(const std::string &name, Stats *stats) {
+  std::lock_guard<std::mutex> lock(mapping_mutex);
+  int fd = open(kFileName, O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  // Blocks are only appended, so the size tells whether the file changed.
+  size_t size = SizeOf(fd);
+  if (size != mapping_size) {
+    if (mapping)
+      munmap(mapping, mapping_size);
+    mapping = nullptr;
+    mapping_size = 0;
+    void *address = (size == 0) ? MAP_FAILED :
+      mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (address != MAP_FAILED) {
+      mapping = address;
+      mapping_size = size;
+    }
+  }
+  close(fd);
+
+  const Block *kBlocks = static_cast<const Block *>(mapping);
+  int num_blocks = static_cast<int>(mapping_size / sizeof(Block));
+  int block_id = FindBlock(kBlocks, num_blocks, KeyOf(name));
+  if (block_id < 0 || kBlocks[block_id].num_games == 0)
+    return false;
+
+  const Block &kBlock = kBlocks[block_id];
+  stats->num_games = static_cast<int>(kBlock.num_games);
+  for (int i = 0; i < kNumSquares; ++i) {
+    for (int j = 0; j < Board::Piece::kNumKindPieces; ++j)
+      stats->counts[i][j] = kBlock.counts[i][j];
+  }
+  return true;
+}
+
+bool FormationStats::Record(const std::string &name, const Board &board,
+                            int characters_id) {
+  // Dummy headquarters are not counted.
+  int kinds[kNumSquares];
+  for (int i = 0; i < kNumSquares; ++i) {
+    Point p = PointOf(i, characters_id);
+    const Board::Piece &kPiece = board.squares()[p.y][p.x];
+    kinds[i] = (kPiece.IsPiece() && kPiece.characters_id == characters_id) ?
+      kPiece.piece : -1;
+  }
+
+  int fd = open(kFileName, O_RDWR | O_CREAT, 0644);
+  if (fd < 0)
+    return false;
+
+  // Writers of all processes take turns. A broken block at the end is
+  // overwritten by the next new opponent.
+  flock(fd, LOCK_EX);
+  int num_blocks = static_cast<int>(SizeOf(fd) / sizeof(Block));
+  size_t size = num_blocks * sizeof(Block);
+  void *address = (size == 0) ? nullptr :
+    mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  bool is_written = false;
+  if (address != MAP_FAILED) {
+    Block *blocks = static_cast<Block *>(address);
+    int block_id = FindBlock(blocks, num_blocks, KeyOf(name));
+    if (0 <= block_id) {
+      AddGame(kinds, &blocks[block_id]);
+      is_written = true;
+    } else {
+      Block block;
+      memset(&block, 0, sizeof(block));
+      block.key = KeyOf(name);
+      AddGame(kinds, &block);
+      is_written = (pwrite(fd, &block, sizeof(block), size) ==
+                    static_cast<ssize_t>(sizeof(block)));
+    }
+    if (address)
+      munmap(address, size);
+  }
+  flock(fd, LOCK_UN);
+  close(fd);
+
+  return is_written;
+}
+
+uint64_t FormationStats::KeyOf(const std::string &name) {
+  // FNV-1a.
+  uint64_t key = 0xcbf29ce484222325ULL;
+  for (int i = 0; i < static_cast<int>(name.size()); ++i) {
+    key ^= static_cast<uint8_t>(name[i]);
+    key *= 0x100000001b3ULL;
+  }
+  return key;
+}
+
+int FormationStats::FindBlock(const Block *blocks, int num_blocks,
+                              uint64_t key) {
+  for (int i = 0; i < num_blocks; ++i) {
+    if (blocks[i].key == key)
+      return i;
+  }
+  return -1;
+}
+
+void FormationStats::AddGame(const int kinds[kNumSquares], Block *block) {
+  for (int i = 0; i < kNumSquares; ++i) {
+    if (0 <= kinds[i])
+      ++block->counts[i][kinds[i]];
+  }
+  ++block->num_games;
+
+  // Counts stay below "kMaxNumGames", which fits in a byte.
+  if (static_cast<int>(block->num_games) < kMaxNumGames)
+    return;
+  block->num_games /= 2;
+  for (int i = 0; i < kNumSquares; ++i) {
+    for (int j = 0; j < Board::Piece::kNumKindPieces; ++j)
+      block->counts[i][j] /= 2;
+  }
+}
\ No newline at end of file
@@ -0,0 +1,67 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016 Hirotaka Nagashima. All rights reserved.
+//-----------------------------------------------------------------------------
+// This class learns formations of each opponent across games and
+// processes. For each square of a formation, the number of games in which
+// each kind started there is kept in a block of "kFileName".
+//   key(8) num_games(4) padding(4) counts(kNumSquares * kNumKindPieces)
+// with integers in the native order. Squares are seen from the back row of
+// the opponent as "Ai::PlaceFormation()".
+//
+// The file is mapped into memory and shared by all processes. A new
+// opponent appends a block, and a game adds to the counts of its block in
+// place while the file is locked, so that readers never wait. A reader
+// may see a game half added, which hardly changes the frequencies.
+// Counts are halved every "kMaxNumGames" games to follow new formations.
+//-----------------------------------------------------------------------------
+
+#ifndef GUNJIN_SHOGI_FORMATION_STATS_H_
+#define GUNJIN_SHOGI_FORMATION_STATS_H_
+
+#include <cstdint>
+#include <string>
+#include "board.h"
+#include "point.h"
+
+class FormationStats {
+public:
+  static const int kNumSquares = Board::kWidth * Board::kHeight / 2;
+  static const int kMaxNumGames = 64;
+  static const char *kFileName;
+
+  struct Stats {
+    int num_games;
+    // Games in which a kind started on a square.
+    int counts[kNumSquares][Board::Piece::kNumKindPieces];
+  };
+
+  // Returns false if no game of the opponent "name" is kept.
+  static bool Find(const std::string &name, Stats *stats);
+  // Adds the formation of "characters_id" on "board" before the first move
+  // to the stats of "name". Returns false if the file is not written.
+  static bool Record(const std::string &name, const Board &board,
+                     int characters_id);
+  // The point of the "square"th square of the formation of "characters_id".
+  static Point PointOf(int square, int characters_id) {
+    int y = square / Board::kWidth;
+    int x = square % Board::kWidth;
+    Point p = {(characters_id == 0) ? y : Board::kHeight - 1 - y,
+               (characters_id == 0) ? x : Board::kWidth - 1 - x};
+    return p;
+  }
+
+private:
+  struct Block {
+    uint64_t key;
+    uint32_t num_games;
+    uint32_t padding;
+    uint8_t counts[kNumSquares][Board::Piece::kNumKindPieces];
+  };
+
+  static uint64_t KeyOf(const std::string &name);
+  // Returns the index of "key" in "blocks", or -1 if it is not found.
+  static int FindBlock(const Block *blocks, int num_blocks, uint64_t key);
+  static void AddGame(const int kinds[kNumSquares], Block *block);
+};
+
+#endif  // GUNJIN_SHOGI_FORMATION_STATS_H_
\ No newline at end of file
@@ -9,24 +9,18 @@
 #include <cstdlib>
 #include <ctime>
 #include "character.h"
+#include "formation_stats.h"
 
 void Game::Initialize() {
   // Reset random seed randomly.
-  srand(static_cast<unsigned int>(time(NULL)));
+  board()->random().Seed(static_cast<uint64_t>(time(NULL)));
 
   // Initialize a window.
   graphic().Initialize();
   
   // Initialize a board randomly.
+  // Pieces are replaced by characters in "Main()".
   board()->Initialize();
-
-  // Replace pieces.
-  for (int player = 0; player < kNumPlayers; ++player) {
-    Character *current_player = characters(player);
-    if (play_with_player())
-      graphic().WaitNextPlayer(current_player->name());
-    current_player->ReplacePieces();
-  }
 }
 
 void Game::Terminate() {
@@ -35,61 +29,169 @@ void Game::Terminate() {
 }
 
 void Game::Main() {
-  bool game_was_drawn;
-  int winners_id;
+  // Replace pieces, then move pieces alternately.
+  while (true) {
+    // Let the player act after animations unless the player clicks.
+    Window *window = graphic().window();
+    if (characters(match()->turn())->type() == Character::kPlayer &&
+        window->is_animating() && !window->HasClick()) {
+      window->WaitEvent();
+      continue;
+    }
 
-  // Move pieces alternately.
-  bool is_end = false;
-  bool is_first = true;
-  for (int id = 0; !is_end; id = 1 - id) {
+    Match::Event event = match()->Resume();
+    int id = match()->turn();
     Character *character = characters(id);
-    Character *opponent = characters(1 - id);
     bool is_players_turn = (Character::kPlayer == character->type());
+    bool is_moving = (match()->phase() == Match::kMoving);
+
+    switch (event) {
+    case Match::kWaiting: {
+      if (is_moving && is_players_turn && hint_is_enabled())
+        DisplayHint(id);
+
+      // Woken up by a click, the ai or the hint.
+      window->WaitEvent(is_players_turn);
+      break;
+    }
+    case Match::kTurnStarted: {
+      // Record the board before the first move.
+      if (is_moving && !replay().is_started())
+        replay().Start(*board());
+
+      // Confirm the player is right one to protect board information
+      // if he plays with another player.
+      if (play_with_player())
+        graphic().WaitNextPlayer(character->name());
+
+      // Display previous move.
+      if (is_moving && is_players_turn && board()->prev_move_is_initialized())
+        DisplayPrevMove(id);
 
-    // Check whether the game ends.
-    is_end = board()->IsEnd(&winners_id, &game_was_drawn);
-    if (is_end && play_with_player())
-      DisplayResult(winners_id, game_was_drawn);
-
-    // Confirm the player is right one to protect board information
-    // if he plays with another player.
-    if (play_with_player())
-      graphic().WaitNextPlayer(character->name());
-
-    // Display previous move.
-    if (is_players_turn && !is_first)
-      DisplayPrevMove(id);
-    is_first = false;
-
-    // Move a piece and battle.
-    if (!is_end) {
-      Move move = character->MovePiece();
-      for (int i = 0; i < kNumPlayers; ++i)
-        characters(i)->UpdateScore();
+      if (is_moving && is_players_turn && hint_is_enabled())
+        StartHint(id);
+      break;
     }
+    case Match::kTurnEnded: {
+      if (is_moving)
+        replay().Record(*board());
 
-    // Display the result of the battle.
-    if (is_players_turn) {
-      graphic().DisplayBoard(*board(), *character);
-      graphic().window()->Sleep(play_with_player() ? 1000 : 0);
+      // Remove the hint before the board changes on the screen.
+      if (is_moving && is_players_turn && hint_is_enabled()) {
+        StopHint();
+        if (HintIsDisplayed())
+          graphic().UnhilightSquares(*board(), id);
+      }
+
+      // Display the result of the battle.
+      if (is_moving && is_players_turn) {
+        graphic().DisplayBoard(*board(), *character);
+        graphic().window()->Sleep(play_with_player() ? 1000 : 0);
+      }
+      break;
+    }
+    default: {
+      RecordFormations();
+      DisplayResult(match()->winners_id(), match()->game_was_drawn());
+      return;
+    }
     }
   }
+}
 
-  DisplayResult(winners_id, game_was_drawn);
+void Game::StartHint(int id) {
+  StopHint();
+  *hint_board_ = *board();
+  hint_ai_ = new Ai(hint_board_, id, "Hint");
+  Ai::SearchLimits limits = {0, kHintMilliseconds, 0};
+  hint_thread_ = std::thread([this, limits]() {
+    hint_ai_->Analyze(limits, kNumHintLines,
+                      [this](const Ai::Analysis &analysis) {
+      {
+        std::lock_guard<std::mutex> lock(hint_mutex_);
+        hint_ = analysis;
+      }
+      graphic().window()->Wake();
+    });
+  });
+}
+
+void Game::StopHint() {
+  if (!hint_ai_)
+    return;
+  hint_ai_->Stop();
+  hint_thread_.join();
+  delete hint_ai_;
+  hint_ai_ = nullptr;
+
+  std::lock_guard<std::mutex> lock(hint_mutex_);
+  hint_.lines.clear();
+}
+
+void Game::DisplayHint(int id) {
+  Move move;
+  {
+    std::lock_guard<std::mutex> lock(hint_mutex_);
+    if (hint_.lines.empty())
+      return;
+    move = hint_.lines[0].move;
+  }
+
+  // Squares hilighted by the player are left as they are.
+  bool hint_is_displayed = HintIsDisplayed();
+  if (!graphic().hilighted_squares().empty() && !hint_is_displayed)
+    return;
+  if (hint_is_displayed && move.src.Equals(displayed_hint_.src) &&
+      move.dest.Equals(displayed_hint_.dest)) {
+    return;
+  }
+
+  graphic().UnhilightSquares(*board(), id);
+  graphic().HilightSquare(move.src, id);
+  graphic().HilightSquare(move.dest, id);
+  displayed_hint_ = move;
+}
+
+bool Game::HintIsDisplayed() {
+  const std::vector<Point> &kSquares = graphic().hilighted_squares();
+  return (kSquares.size() == 2 && kSquares[0].Equals(displayed_hint_.src) &&
+          kSquares[1].Equals(displayed_hint_.dest));
 }
 
 void Game::DisplayPrevMove(int id) {
   Character * const character = characters(id);
-  Move prev_move = board()->prev_move();
-  board()->Undo();
-  graphic().DisplayBoard(*board(), *character);
-  graphic().window()->Sleep(100);
-  graphic().HilightSquare(prev_move.src, id);
-  graphic().window()->Sleep(100);
-  graphic().HilightSquare(prev_move.dest, id);
-  graphic().window()->Sleep(550);
-  board()->Battle(prev_move);
-  graphic().UnhilightSquares(*board(), id);
+  Move prev_move = replay().move(replay().num_plies());
+
+  // Display the board before the move without touching the live one.
+  Board prev_board;
+  replay().Seek(replay().num_plies() - 1, &prev_board);
+  graphic().DisplayBoard(prev_board, *character);
+
+  // Hilight the move, then display the current board.
+  Window *window = graphic().window();
+  window->Schedule(100, [this, prev_move, id]() {
+    graphic().HilightSquare(prev_move.src, id);
+  });
+  window->Schedule(200, [this, prev_move, id]() {
+    graphic().HilightSquare(prev_move.dest, id);
+  });
+  window->Schedule(750, [this, id]() {
+    graphic().UnhilightSquares(*board(), id);
+  });
+}
+
+void Game::RecordFormations() {
+  // Pieces are revealed after the game.
+  if (!replay().is_started())
+    return;
+  Board first_board;
+  replay().Seek(0, &first_board);
+  for (int i = 0; i < kNumPlayers; ++i) {
+    if (characters(i)->type() == Character::kPlayer &&
+        characters(1 - i)->type() == Character::kAi) {
+      FormationStats::Record(characters(i)->name(), first_board, i);
+    }
+  }
 }
 
 void Game::DisplayResult(int winners_id, bool game_was_drawn) {
@@ -7,26 +7,58 @@
 #ifndef GUNJIN_SHOGI_GAME_H_
 #define GUNJIN_SHOGI_GAME_H_
 
+#include <mutex>
+#include <string>
+#include <thread>
 #include "board.h"
 #include "player.h"
 #include "ai.h"
+#include "ai_scheduler.h"
 #include "graphic.h"
+#include "match.h"
+#include "replay.h"
 
 class Character;
 class Game {
 public:
   static const int kNumPlayers = 2;
+  // The ai must move within this.
+  static const int kAiDeadlineMilliseconds = 3000;
+  // A hint is refined at most this long while the player thinks.
+  static const int kHintMilliseconds = 10000;
+  static const int kNumHintLines = 3;
+
+  // "level" is of the ai, which learns formations of "players_name".
+  explicit Game(Ai::Level level = Ai::kNormal,
+                const std::string &players_name = "Player1")
+      : board_(new Board),
+        hint_board_(new Board),
+        hint_ai_(nullptr),
+        hint_is_enabled_(false),
+        displayed_hint_() {
+    // The ai thinks on a worker while the window keeps working.
+    Ai::SearchLimits limits = {0, 0, 0};
+    scheduler_ = new AiScheduler(1, limits);
 
-  Game() : board_(new Board) {
     // Register characters.
     // If you want to play with a human, edit here.
-    set_characters(0, new Player(&graphic(), board(), 0, "Player1"));
+    set_characters(0, new Player(&graphic(), board(), 0, players_name));
     //set_characters(1, new Player(&graphic(), board(), 1, "Player2"));
-    set_characters(1, new Ai(board(), 1, "Computer"));
+    Ai *ai = new Ai(board(), 1, "Computer");
+    ai->set_level(level);
+    ai->set_opponents_name(players_name);
+    ai->set_scheduler(scheduler(), kAiDeadlineMilliseconds,
+                      [this]() { graphic().window()->Wake(); });
+    set_characters(1, ai);
     set_play_with_player(Character::kPlayer == characters(0)->type() &&
                          Character::kPlayer == characters(1)->type());
+    match_ = new Match(board(), characters(0), characters(1));
   }
   ~Game() {
+    StopHint();
+    delete hint_board_;
+    delete scheduler();
+    delete match();
     delete board();
     delete characters(0);
     delete characters(1);
@@ -36,13 +68,36 @@ public:
   void Terminate();
   void Main();
 
+  int max_num_plies() const { return match()->max_num_plies(); }
+  void set_max_num_plies(int max_num_plies) {
+    match()->set_max_num_plies(max_num_plies);
+  }
+  // Whether the move the ai suggests is hilighted while the player thinks.
+  bool hint_is_enabled() const { return hint_is_enabled_; }
+  void set_hint_is_enabled(bool hint_is_enabled) {
+    hint_is_enabled_ = hint_is_enabled;
+  }
+
 private:
+  // The hint is analyzed on a copy of the board by another thread, seen
+  // from the player with suppositions of the player.
+  void StartHint(int id);
+  void StopHint();
+  // Hilights the best move of the latest analysis unless the player is
+  // selecting a move.
+  void DisplayHint(int id);
+  bool HintIsDisplayed();
   void DisplayPrevMove(int id);
+  // Adds formations of players against ais to "FormationStats".
+  void RecordFormations();
   void DisplayResult(int winners_id, bool game_was_drawn);
 
   Graphic &graphic() { return graphic_; }
   Character *characters(int id) const { return characters_[id]; }
   Board *board() const { return board_; }
+  Match *match() const { return match_; }
+  AiScheduler *scheduler() const { return scheduler_; }
+  Replay &replay() { return replay_; }
   bool play_with_player() const { return play_with_player_; }
   void set_play_with_player(bool play_with_player) {
     play_with_player_ = play_with_player;
@@ -55,6 +110,18 @@ private:
   Character *characters_[kNumPlayers];
   Board *board_;
   bool play_with_player_;
+  Match *match_;
+  Replay replay_;
+  AiScheduler *scheduler_;
+  Board *hint_board_;
+  Ai *hint_ai_;
+  std::thread hint_thread_;
+  bool hint_is_enabled_;
+  // Written by the thread of the hint.
+  std::mutex hint_mutex_;
+  Ai::Analysis hint_;
+  // On the screen.
+  Move displayed_hint_;
 };
 
 #endif  // GUNJIN_SHOGI_GAME_H_
\ No newline at end of file
@@ -6,34 +6,77 @@
 
 #include "graphic.h"
 #include <algorithm>
+#include <thread>
 #include "character.h"
 #include "point.h"
 #include "board.h"
+#include "resources.h"
 
-void Graphic::Initialize() {
-  window_->Initialize();
-
-  // Load images.
-  image_board_ = IMG_Load("src/resources/board.png");
-  image_piece_ = IMG_Load("src/resources/piece.png");
-  image_label_ = IMG_Load("src/resources/label.png");
-  image_supposition_label_ = IMG_Load("src/resources/supposition_label.png");
-  image_overlay_ = IMG_Load("src/resources/overlay.png");
-  image_hilight_ = IMG_Load("src/resources/hilight.png");
-  image_determining_button_ = IMG_Load("src/resources/determining_button.png");
-  image_cross_ = IMG_Load("src/resources/cross.png");
-  if (!image_board_ || !image_piece_ || !image_label_ ||
-      !image_supposition_label_ || !image_overlay_ || !image_hilight_ ||
-      !image_determining_button_ || !image_cross_) {
-    fprintf(stderr, "ERROR: %s\n", IMG_GetError());
+namespace {
+
+const char *kFontName = "font.ttf";
+
+// Opens an embedded resource or a file.
+SDL_RWops *OpenResource(const char *name) {
+  const Resources::Embedded *embedded = Resources::FindEmbedded(name);
+  if (embedded)
+    return SDL_RWFromConstMem(embedded->data, embedded->size);
+  return SDL_RWFromFile(Resources::ToPath(name).c_str(), "rb");
+}
+
+bool IsSamePiece(const Board::Piece &a, const Board::Piece &b) {
+  return (a.piece == b.piece && a.supposition == b.supposition &&
+          a.characters_id == b.characters_id);
+}
+
+}  // namespace
+
+void Graphic::Initialize(bool is_offscreen) {
+  // Decode images on threads while the window is created.
+  const int kNumImages = 8;
+  const char *kImageNames[kNumImages] = {
+      "board.png", "piece.png", "label.png", "supposition_label.png",
+      "overlay.png", "hilight.png", "determining_button.png", "cross.png"};
+  SDL_Surface **images[kNumImages] = {
+      &image_board_, &image_piece_, &image_label_, &image_supposition_label_,
+      &image_overlay_, &image_hilight_, &image_determining_button_,
+      &image_cross_};
+  IMG_Init(IMG_INIT_PNG);
+  std::vector<std::thread> decoders;
+  for (int i = 0; i < kNumImages; ++i) {
+    decoders.push_back(std::thread([&images, &kImageNames, i]() {
+      *images[i] = IMG_Load_RW(OpenResource(kImageNames[i]), 1);
+    }));
+  }
+  if (is_offscreen)
+    window_->InitializeOffscreen();
+  else
+    window_->Initialize();
+  for (int i = 0; i < kNumImages; ++i)
+    decoders[i].join();
+
+  // Convert images, whose format is known after the window is created.
+  for (int i = 0; i < kNumImages; ++i) {
+    if (!*images[i]) {
+      fprintf(stderr, "ERROR: %s can't be loaded.\n",
+              Resources::ToPath(kImageNames[i]).c_str());
+      exit(-1);
+    }
+    *images[i] = ConvertImage(*images[i]);
+  }
+  PrerenderPieces();
+
+  // Load fonts from one copy of the file.
+  if (!Resources::FindEmbedded(kFontName) &&
+      !Resources::Read(kFontName, &font_data_)) {
+    fprintf(stderr, "ERROR: %s is not existed.\n",
+            Resources::ToPath(kFontName).c_str());
     exit(-1);
   }
-  
-  // Load fonts.
-  font_ = TTF_OpenFont("src/resources/font.ttf", 50);
-  small_font_ = TTF_OpenFont("src/resources/font.ttf", 25);
-  smaller_font_ = TTF_OpenFont("src/resources/font.ttf", 20);
-  if (!font_ || !small_font_) {
+  font_ = OpenFont(50);
+  small_font_ = OpenFont(25);
+  smaller_font_ = OpenFont(20);
+  if (!font_ || !small_font_ || !smaller_font_) {
     fprintf(stderr, "ERROR: %s\n", TTF_GetError());
     exit(-1);
   }
@@ -49,21 +92,29 @@ void Graphic::Terminate() {
   SDL_FreeSurface(image_hilight_);
   SDL_FreeSurface(image_determining_button_);
   SDL_FreeSurface(image_cross_);
+  SDL_FreeSurface(image_sprites_);
   TTF_CloseFont(font_);
   TTF_CloseFont(small_font_);
   TTF_CloseFont(smaller_font_);
+  font_data_.clear();
 
   window_->Terminate();
 }
 
 Point Graphic::GetClickedPosition(int characters_id) {
   // Wait for a mouse event.
+  window()->UpdateSurface();
   SDL_Event event;
   SDL_WaitEvent(&event);
 
   // Get the clicked coordinates.
   Point clicked_coordinates = window()->WaitClick(true);
 
+  return ToPosition(clicked_coordinates, characters_id);
+}
+
+Point Graphic::ToPosition(const Point &clicked_coordinates,
+                          int characters_id) const {
   // Calculate clicked id of board.
   Point clicked_position;
   clicked_position.y = clicked_coordinates.y / 50 - 1;
@@ -91,6 +142,7 @@ void Graphic::DisplayResult(const Board &board,
   // Overlay.
   window_->DrawSingleImage(image_overlay_, 0, 0);
   hilighted_squares().clear();
+  board_is_displayed_ = false;
 
   // Draw winner's name.
   if (game_was_drawn) {
@@ -108,24 +160,50 @@ void Graphic::DisplayResult(const Board &board,
 }
 
 void Graphic::DisplayBoard(const Board &board, const Character &character) {
-  // Draw a background.
-  window_->DrawSingleImage(image_board_, 0, 0);
+  // Redraw all if the board was hidden or seen from the other side.
+  bool is_redrawn = (!board_is_displayed_ ||
+                     displayed_characters_id_ != character.id());
+  if (is_redrawn)
+    window_->DrawSingleImage(image_board_, 0, 0);
+
+  // Draw a player's name and score at the top of the screen.
+  if (is_redrawn || displayed_name_ != character.name() ||
+      displayed_score_ != character.score()) {
+    if (!is_redrawn) {
+      for (int x = 0; x <= Board::kWidth; ++x)
+        window_->DrawImage(image_board_, 50 * x, 0, x, 50, 50);
+    }
+    window_->DrawString(character.name().c_str(), 10, -5, font_);
+    char score[10];
+    snprintf(score, sizeof(score), "%+2d", character.score());
+    window_->DrawGlyphs(score, 305, 10, smaller_font_);
+  }
+  board_is_displayed_ = true;
+  displayed_characters_id_ = character.id();
+  displayed_name_ = character.name();
+  displayed_score_ = character.score();
+
+  // Hilighted squares are redrawn as changed ones.
+  for (int i = 0; i < static_cast<int>(hilighted_squares().size()); ++i) {
+    const Point &p = hilighted_squares()[i];
+    displayed_pieces_[p.y][p.x].characters_id = -1;
+  }
   hilighted_squares().clear();
 
-  // Draw a player's name at the top of the screen.
-  window_->DrawString(character.name().c_str(), 10, -5, font_);
-
-  // Draw a player's score.
-  char score[10];
-  snprintf(score, sizeof(score), "%+2d", character.score());
-  window_->DrawString(score, 305, 10, smaller_font_);
-
   // Draw pieces.
   Point point;
   for (point.y = 0; point.y < Board::kHeight; ++point.y) {
     for (point.x = 0; point.x < Board::kWidth; ++point.x) {
-      // Skip a invisible piece.
+      // Draw only changed squares over the board on the screen.
       Board::Piece piece = board.board(point);
+      if (!is_redrawn) {
+        if (!IsSamePiece(piece, displayed_pieces_[point.y][point.x]))
+          DisplayPiece(board, point, character.id());
+        continue;
+      }
+      displayed_pieces_[point.y][point.x] = piece;
+
+      // Skip a invisible piece.
       if (!piece.IsPiece() || board.IsDummyHeadquarters(point))
         continue;
 
@@ -161,6 +239,7 @@ void Graphic::DisplayBoard(const Board &board, const Character &character) {
 void Graphic::WaitNextPlayer(const std::string &name) {
   window()->ClearScreen();
   hilighted_squares().clear();
+  board_is_displayed_ = false;
 
   // Draw next player's name.
   std::string temp = name + "?";
@@ -192,9 +271,6 @@ void Graphic::HilightSquare(const Point &point, int characters_id) {
 
   // Draw square overlay.
   window_->DrawSingleImage(image_hilight_, dest.x, dest.y);
-  
-  // Display.
-  window_->UpdateSurface();
 }
 
 void Graphic::UnhilightSquares(const Board &board, int character_id) {
@@ -222,14 +298,11 @@ void Graphic::CrossCell(const Point &point, int characters_id) {
 
   // Draw square overlay.
   window_->DrawSingleImage(image_cross_, dest.x, dest.y);
-
-  // Display.
-  window_->UpdateSurface();
 }
 
 void Graphic::DisplayDeterminingButton() {
   window_->DrawSingleImage(image_determining_button_, 0, 50);
-  window_->UpdateSurface();
+  board_is_displayed_ = false;
 }
 
 void Graphic::DisplayPiece(const Board &board, const Point &point,
@@ -259,6 +332,8 @@ void Graphic::DisplayPiece(const Board &board, const Point &point,
     window_->DrawImage(image_board_, dest.x + 50, dest.y, id + 1, 50, 50);
     DrawPiece(piece_is_current_characters, dest.x + 25, dest.y,
               board.board(point));
+    displayed_pieces_[point.y][Board::kWidth / 2 - 1] = piece;
+    displayed_pieces_[point.y][Board::kWidth / 2] = piece;
   } else {
     // Calculate destination to draw the piece.
     Point dest;
@@ -280,10 +355,8 @@ void Graphic::DisplayPiece(const Board &board, const Point &point,
     // Draw the part of the background and the piece.
     window_->DrawImage(image_board_, dest.x, dest.y, id, 50, 50);
     DrawPiece(piece_is_current_characters, dest.x, dest.y, piece);
+    displayed_pieces_[point.y][point.x] = piece;
   }
-
-  // Display.
-  window_->UpdateSurface();
 }
 
 Board::Piece::KindPiece Graphic::GetSupposition() {
@@ -296,6 +369,11 @@ Board::Piece::KindPiece Graphic::GetSupposition() {
   // Get the clicked coordinates.
   Point clicked_coordinates = window()->WaitClick(true);
 
+  return ToSupposition(clicked_coordinates);
+}
+
+Board::Piece::KindPiece Graphic::ToSupposition(
+    const Point &clicked_coordinates) const {
   // Calculate clicked id of board.
   Point clicked_position;
   clicked_position.y = (clicked_coordinates.y - 125) / 50;
@@ -324,6 +402,7 @@ Board::Piece::KindPiece Graphic::GetSupposition() {
 
 void Graphic::DisplaySuppositionMenu() {
   window()->DrawSingleImage(image_overlay_, 0, 0);
+  board_is_displayed_ = false;
 
   // Draw all kinds of pieces.
   for (int i = 0; i < Board::Piece::kNumKindPieces; ++i) {
@@ -337,18 +416,77 @@ void Graphic::DisplaySuppositionMenu() {
   window_->UpdateSurface();
 }
 
+SDL_Surface *Graphic::ConvertImage(SDL_Surface *image) {
+  SDL_Surface *converted_image;
+  if (image->format->Amask) {
+    converted_image =
+        SDL_ConvertSurfaceFormat(image, SDL_PIXELFORMAT_ARGB8888, 0);
+  } else {
+    converted_image =
+        SDL_ConvertSurface(image, window_->video_surface()->format, 0);
+  }
+  SDL_FreeSurface(image);
+  if (!converted_image) {
+    fprintf(stderr, "ERROR: %s\n", SDL_GetError());
+    exit(-1);
+  }
+  return converted_image;
+}
+
+TTF_Font *Graphic::OpenFont(int size) {
+  const Resources::Embedded *embedded = Resources::FindEmbedded(kFontName);
+  SDL_RWops *font = embedded ?
+      SDL_RWFromConstMem(embedded->data, embedded->size) :
+      SDL_RWFromConstMem(font_data_.data(),
+                         static_cast<int>(font_data_.size()));
+  return TTF_OpenFontRW(font, 1, size);
+}
+
+void Graphic::PrerenderPieces() {
+  image_sprites_ = SDL_CreateRGBSurfaceWithFormat(
+      0, 50 * kNumSpriteColumns, 50 * 3, 32, SDL_PIXELFORMAT_ARGB8888);
+  if (!image_sprites_) {
+    fprintf(stderr, "ERROR: %s\n", SDL_GetError());
+    exit(-1);
+  }
+
+  // Put a label on a piece for each sprite.
+  for (int id = 0; id <= kNoSuppositionSprite; ++id) {
+    bool is_current_characters = (id < kNumSpriteColumns);
+    int kind = id % kNumSpriteColumns;
+    SDL_Rect dest = {(id % kNumSpriteColumns) * 50,
+                     (id / kNumSpriteColumns) * 50, 50, 50};
+    SDL_Rect src = {is_current_characters ? 0 : 50, 0, 50, 50};
+    SDL_Rect copied_dest = dest;
+    SDL_SetSurfaceBlendMode(image_piece_, SDL_BLENDMODE_NONE);
+    SDL_BlitSurface(image_piece_, &src, image_sprites_, &copied_dest);
+    SDL_SetSurfaceBlendMode(image_piece_, SDL_BLENDMODE_BLEND);
+    if (id == kNoSuppositionSprite)
+      continue;
+
+    SDL_Surface *label = is_current_characters ? image_label_ :
+                                                 image_supposition_label_;
+    int num_columns = label->w / 50;
+    src.x = (kind % num_columns) * 50;
+    src.y = (kind / num_columns) * 50;
+    copied_dest = dest;
+    SDL_BlitSurface(label, &src, image_sprites_, &copied_dest);
+  }
+  SDL_SetSurfaceBlendMode(image_sprites_, SDL_BLENDMODE_BLEND);
+}
+
 void Graphic::DrawPiece(bool piece_is_current_characters,
                         int dest_x, int dest_y, const Board::Piece &piece) {
   if (!piece.IsPiece())
     return;
-  if (piece_is_current_characters) {
-    window_->DrawImage(image_piece_, dest_x, dest_y, 0, 50, 50);
-    window_->DrawImage(image_label_, dest_x, dest_y, piece.piece, 50, 50);
-  } else {
-    window_->DrawImage(image_piece_, dest_x, dest_y, 1, 50, 50);
-    if (piece.supposition != Board::Piece::kNone) {
-      window_->DrawImage(image_supposition_label_, dest_x, dest_y,
-                         piece.supposition, 50, 50);
-    }
-  }
+
+  // Draw a piece with its label at once.
+  int id;
+  if (piece_is_current_characters)
+    id = piece.piece;
+  else if (piece.supposition == Board::Piece::kNone)
+    id = kNoSuppositionSprite;
+  else
+    id = kNumSpriteColumns + piece.supposition;
+  window_->DrawImage(image_sprites_, dest_x, dest_y, id, 50, 50);
 }
\ No newline at end of file
@@ -7,6 +7,7 @@
 #ifndef SDL_GRAPHIC_H_
 #define SDL_GRAPHIC_H_
 
+#include <string>
 #include <vector>
 #include "window.h"
 #include "board.h"
@@ -16,14 +17,26 @@ class Character;
 class Board;
 class Graphic {
 public:
-  Graphic() { window_ = new Window(350, 450, "Gunjin Shogi"); }
+  Graphic() : board_is_displayed_(false) {
+    window_ = new Window(350, 450, "Gunjin Shogi");
+  }
   ~Graphic() { delete window_; }
 
-  void Initialize();
+  // Nothing is displayed if "is_offscreen", and frames are saved by
+  // "SaveFrame()". SDL must be initialized by the caller then.
+  void Initialize(bool is_offscreen = false);
   void Terminate();
+  bool SaveFrame(const char *file_name) const {
+    return window_->SavePng(file_name);
+  }
   Point GetClickedPosition(int characters_id);
+  // Converts clicked coordinates into a position on the board.
+  Point ToPosition(const Point &coordinates, int characters_id) const;
+  // Converts clicked coordinates on the supposition menu into a kind.
+  Board::Piece::KindPiece ToSupposition(const Point &coordinates) const;
   void DisplayResult(const Board &board, const std::string &winners_name,
                      bool game_was_drawn);
+  // Only changed squares are redrawn while the board is on the screen.
   void DisplayBoard(const Board &board, const Character &character);
   void WaitNextPlayer(const std::string &name);
   void HilightSquare(const Point &p, int characters_id);
@@ -31,21 +44,42 @@ public:
   void CrossCell(const Point &p, int characters_id);
   void DisplayDeterminingButton();
   // Use this instead of "DisplayBoard()" for lighter processing.
+  // Squares drawn by these are displayed at the next input event.
   void DisplayPiece(const Board &board, const Point &point, int characters_id);
   Board::Piece::KindPiece GetSupposition();
+  void DisplaySuppositionMenu();
 
   Window *window() { return window_; }
   std::vector<Point> &hilighted_squares() { return hilighted_squares_; }
 
 private:
-  void DisplaySuppositionMenu();
+  // Sprites of pieces of the current character for each kind, then of
+  // the other for each supposition and for no supposition.
+  static const int kNumSpriteColumns = Board::Piece::kNumKindPieces;
+  static const int kNoSuppositionSprite = 2 * kNumSpriteColumns;
+
+  // Converts an image into the format of the window once to blit it
+  // without conversion. Images with alpha are kept in 32 bit ARGB.
+  // "image" is released.
+  SDL_Surface *ConvertImage(SDL_Surface *image);
+  // Fonts of all sizes share the data of the file.
+  TTF_Font *OpenFont(int size);
+  void PrerenderPieces();
   void DrawPiece(bool piece_is_current_characters,
                  int dest_x, int dest_y, const Board::Piece &piece);
 
   std::vector<Point> hilighted_squares_;
   Window *window_;
 
+  // The board on the screen.
+  Board::Piece displayed_pieces_[Board::kHeight][Board::kWidth];
+  int displayed_characters_id_;
+  std::string displayed_name_;
+  int displayed_score_;
+  bool board_is_displayed_;
+
   // Resources.
+  std::string font_data_;
   TTF_Font *font_;
   TTF_Font *small_font_;
   TTF_Font *smaller_font_;
@@ -57,6 +91,7 @@ private:
   SDL_Surface *image_hilight_;
   SDL_Surface *image_determining_button_;
   SDL_Surface *image_cross_;
+  SDL_Surface *image_sprites_;
 };
 
 #endif  // SDL_GRAPHIC_H_
\ No newline at end of file
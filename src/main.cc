@@ -19,7 +19,26 @@ extern "C" FILE * __cdecl __iob_func() {
 // NOTE: Format of the main function must be shown below for SDL.
 // int main(int argc, char *argv[]) { ~ return 0; }
 int main(int argc, char *argv[]) {
-  Game game;
+  // "-level <beginner|easy|normal|hard>" is of the ai.
+  // "-hint" hilights the move the ai suggests while the player thinks.
+  // "-name <name>" is of the player, whose formations the ai learns.
+  Ai::Level level = Ai::kNormal;
+  std::string players_name = "Player1";
+  bool hint_is_enabled = false;
+  for (int i = 1; i < argc; ++i) {
+    std::string option = argv[i];
+    if (option == "-level" && i + 1 < argc &&
+        Ai::ParseLevel(argv[i + 1], &level)) {
+      ++i;
+    } else if (option == "-hint") {
+      hint_is_enabled = true;
+    } else if (option == "-name" && i + 1 < argc) {
+      players_name = argv[++i];
+    }
+  }
+
+  Game game(level, players_name);
+  game.set_hint_is_enabled(hint_is_enabled);
   game.Initialize();
   game.Main();
   game.Terminate();
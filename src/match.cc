@@ -0,0 +1,61 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016 Hirotaka Nagashima. All rights reserved.
+//-----------------------------------------------------------------------------
+// Information on this class is described in "match.h".
+//-----------------------------------------------------------------------------
+
+#include "match.h"
+
+Match::Event Match::Resume() {
+  // Go to the next turn.
+  if (turn_is_ended_) {
+    turn_is_ended_ = false;
+    turn_ = 1 - turn_;
+    if (phase_ == kReplacing && turn_ == 0)
+      phase_ = kMoving;
+  }
+
+  switch (phase_) {
+  case kReplacing: {
+    if (!turn_is_started_) {
+      turn_is_started_ = true;
+      return kTurnStarted;
+    }
+
+    // Replace pieces.
+    if (characters_[turn_]->ResumeReplacePieces() == Character::kWaiting)
+      return kWaiting;
+    break;
+  }
+  case kMoving: {
+    if (!turn_is_started_) {
+      // Check whether the game ends.
+      bool is_end = board_->IsEnd(&winners_id_, &game_was_drawn_) ||
+                    board_->IsAdjudicated(max_num_plies_,
+                                          &winners_id_, &game_was_drawn_);
+      if (is_end) {
+        phase_ = kEnded;
+        return kGameEnded;
+      }
+
+      turn_is_started_ = true;
+      return kTurnStarted;
+    }
+
+    // Move a piece and battle.
+    Move move;
+    if (characters_[turn_]->ResumeMovePiece(&move) == Character::kWaiting)
+      return kWaiting;
+    for (int i = 0; i < Board::kNumPlayers; ++i)
+      characters_[i]->UpdateScore();
+    break;
+  }
+  default: {
+    return kGameEnded;
+  }
+  }
+
+  turn_is_started_ = false;
+  turn_is_ended_ = true;
+  return kTurnEnded;
+}
\ No newline at end of file
@@ -0,0 +1,72 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016 Hirotaka Nagashima. All rights reserved.
+//-----------------------------------------------------------------------------
+// This class runs a game as a resumable state machine without a window.
+// "Resume()" returns whenever a character waits, or a turn starts or ends,
+// so that the caller can draw or send something and resume it later.
+//-----------------------------------------------------------------------------
+
+#ifndef GUNJIN_SHOGI_MATCH_H_
+#define GUNJIN_SHOGI_MATCH_H_
+
+#include <cassert>
+#include "board.h"
+#include "character.h"
+
+class Match {
+public:
+  enum Phase {
+    kReplacing,
+    kMoving,
+    kEnded,
+  };
+  enum Event {
+    kWaiting,  // The current character waits for something.
+    kTurnStarted,
+    kTurnEnded,
+    kGameEnded,
+  };
+
+  Match(Board *board, Character *first, Character *second)
+      : board_(board),
+        phase_(kReplacing),
+        turn_(0),
+        turn_is_started_(false),
+        turn_is_ended_(false),
+        max_num_plies_(Board::kDefaultMaxNumPlies),
+        winners_id_(0),
+        game_was_drawn_(false) {
+    characters_[0] = first;
+    characters_[1] = second;
+  }
+
+  Event Resume();
+
+  Phase phase() const { return phase_; }
+  // The id of the character of the current turn.
+  int turn() const { return turn_; }
+  int winners_id() const { return winners_id_; }
+  bool game_was_drawn() const { return game_was_drawn_; }
+  int max_num_plies() const { return max_num_plies_; }
+  void set_max_num_plies(int max_num_plies) {
+    // Leave room on the undo stack for the ai to search.
+    assert(max_num_plies <= Board::kDefaultMaxNumPlies);
+    max_num_plies_ = max_num_plies;
+  }
+
+private:
+  friend class Snapshot;
+
+  Board *board_;
+  Character *characters_[Board::kNumPlayers];
+  Phase phase_;
+  int turn_;
+  bool turn_is_started_;
+  // The next turn starts at the next call.
+  bool turn_is_ended_;
+  int max_num_plies_;
+  int winners_id_;
+  bool game_was_drawn_;
+};
+
+#endif  // GUNJIN_SHOGI_MATCH_H_
\ No newline at end of file
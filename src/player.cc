@@ -10,90 +10,139 @@
 #include "point.h"
 
 void Player::ReplacePieces() {
-  // Display a current board.
-  graphic()->DisplayBoard(*board(), *this);
-  graphic()->DisplayDeterminingButton();
-
-  // Replace pieces.
-  while (true) {
-    graphic()->UnhilightSquares(*board(), id());
-
-    // Determine a source and hilight one.
-    Move move;
-    move.src = graphic()->GetClickedPosition(id());
-
-    // If outside of my board was clicked, end replacing phase.
-    if (board()->board(move.src).characters_id != id()) {
-      // Skip to read mouse up.
-      graphic()->window()->WaitClick(true);
+  while (ResumeReplacePieces() == kWaiting)
+    graphic()->window()->WaitEvent();
+}
 
-      // End replacing phase.
-      std::vector<Point> error;
-      if (board()->IsValid(id(), &error))
-        break;
+Move Player::MovePiece() {
+  Move move;
+  while (ResumeMovePiece(&move) == kWaiting)
+    graphic()->window()->WaitEvent();
+  return move;
+}
 
-      // If there is an unavailable position, display one.
-      for (int i = 0; i < static_cast<int>(error.size()); ++i)
-        graphic()->CrossCell(error[i], id());
-      graphic()->window()->Sleep(300);
+Character::TurnStatus Player::ResumeReplacePieces() {
+  // Display a current board.
+  if (state_ == kIdle) {
+    graphic()->DisplayBoard(*board(), *this);
+    graphic()->DisplayDeterminingButton();
+    state_ = kSelectingSource;
+  }
 
-      continue;
+  // Replace pieces.
+  Point coordinates;
+  while (graphic()->window()->PollClick(&coordinates)) {
+    Point clicked_position = graphic()->ToPosition(coordinates, id());
+    if (state_ == kSelectingSource) {
+      // Determine a source and hilight one.
+      move_.src = clicked_position;
+
+      // If outside of my board was clicked, end replacing phase.
+      if (board()->board(move_.src).characters_id != id()) {
+        // End replacing phase.
+        std::vector<Point> error;
+        if (board()->IsValid(id(), &error)) {
+          state_ = kIdle;
+          return kDone;
+        }
+
+        // If there is an unavailable position, display one for a while.
+        for (int i = 0; i < static_cast<int>(error.size()); ++i)
+          graphic()->CrossCell(error[i], id());
+        graphic()->window()->Schedule(300, [this]() {
+          graphic()->UnhilightSquares(*board(), id());
+        });
+        continue;
+      } else {
+        // Hilight the piece at the source.
+        graphic()->HilightSquare(move_.src, id());
+        state_ = kSelectingDestination;
+      }
+    } else {
+      // Determine a destination and hilight one.
+      move_.dest = clicked_position;
+      state_ = kSelectingSource;
+      if (board()->board(move_.dest).characters_id == id()) {
+        graphic()->HilightSquare(move_.dest, id());
+
+        // Swap them and display current state of the board a bit later.
+        board()->Swap(move_);
+        graphic()->window()->Schedule(50, [this]() {
+          graphic()->UnhilightSquares(*board(), id());
+        });
+        continue;
+      }
     }
 
-    // Hilight the piece at the source.
-    graphic()->HilightSquare(move.src, id());
-
-    // Determine a destination and hilight one.
-    move.dest = graphic()->GetClickedPosition(id());
-    if (board()->board(move.dest).characters_id != id())
-      continue;
-    graphic()->HilightSquare(move.dest, id());
-    graphic()->window()->Sleep(50);
-
-    // Swap them and display current state of the board.
-    board()->Swap(move);
+    if (state_ == kSelectingSource)
+      graphic()->UnhilightSquares(*board(), id());
   }
+
+  return kWaiting;
 }
 
-Move Player::MovePiece() {
+Character::TurnStatus Player::ResumeMovePiece(Move *move) {
   // Display first state of the board.
-  graphic()->DisplayBoard(*board(), *this);
+  if (state_ == kIdle) {
+    graphic()->DisplayBoard(*board(), *this);
+    state_ = kSelectingSource;
+  }
 
   // Determine how to move.
-  Move move;
-  while (true) {
-    graphic()->UnhilightSquares(*board(), id());
-
-    // Determine a source.
-    move.src = graphic()->GetClickedPosition(id());
-    
-    // If an opponent's piece was clicked, show supposition menu.
-    Board::Piece src_piece = board()->board(move.src);
-    if (src_piece.characters_id != id() && src_piece.IsPiece()) {
-      Board::Piece supposition = board()->board(move.src);
-      supposition.supposition = graphic()->GetSupposition();
-      board()->set_board(supposition, move.src);
-      graphic()->DisplayBoard(*board(), *this);
-      continue;
-    }
-
-    // Count the number of the squares the piece can place and hilight them.
-    HighlightPlaceableSquares(move.src);
+  Point coordinates;
+  while (graphic()->window()->PollClick(&coordinates)) {
+    switch (state_) {
+    case kSelectingSource: {
+      // Determine a source.
+      move_.src = graphic()->ToPosition(coordinates, id());
+
+      // If an opponent's piece was clicked, show supposition menu.
+      Board::Piece src_piece = board()->board(move_.src);
+      if (src_piece.characters_id != id() && src_piece.IsPiece()) {
+        graphic()->DisplaySuppositionMenu();
+        state_ = kSelectingSupposition;
+        break;
+      }
 
-    // If the piece can place nowhere, continue.
-    if (graphic()->hilighted_squares().empty())
-      continue;
+      // Count the number of the squares the piece can place
+      // and hilight them.
+      HighlightPlaceableSquares(move_.src);
 
-    graphic()->HilightSquare(move.src, id());
+      // If the piece can place nowhere, continue.
+      if (graphic()->hilighted_squares().empty())
+        break;
 
-    // Determine a destination.
-    move.dest = graphic()->GetClickedPosition(id());
-    if (board()->IsMoveValid(move))
+      graphic()->HilightSquare(move_.src, id());
+      state_ = kSelectingDestination;
       break;
+    }
+    case kSelectingSupposition: {
+      Board::Piece supposition = board()->board(move_.src);
+      supposition.supposition = graphic()->ToSupposition(coordinates);
+      board()->set_board(supposition, move_.src);
+      graphic()->DisplayBoard(*board(), *this);
+      state_ = kSelectingSource;
+      break;
+    }
+    default: {
+      // Determine a destination.
+      move_.dest = graphic()->ToPosition(coordinates, id());
+      if (board()->IsMoveValid(move_)) {
+        board()->Battle(move_);
+        *move = move_;
+        state_ = kIdle;
+        return kDone;
+      }
+      state_ = kSelectingSource;
+      break;
+    }
+    }
+
+    if (state_ == kSelectingSource)
+      graphic()->UnhilightSquares(*board(), id());
   }
 
-  board()->Battle(move);
-  return move;
+  return kWaiting;
 }
 
 void Player::HighlightPlaceableSquares(const Point &src) const {
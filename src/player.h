@@ -15,16 +15,30 @@ class Player : public Character {
 public:
   Player(Graphic *graphic, Board *board, int id, const std::string &name)
       : Character(kPlayer, board, id, name),
-        graphic_(graphic) {}
+        graphic_(graphic),
+        state_(kIdle) {}
 
   void ReplacePieces();
   Move MovePiece();
+  TurnStatus ResumeReplacePieces();
+  TurnStatus ResumeMovePiece(Move *move);
 
 private:
+  // What the next click means.
+  enum State {
+    kIdle,
+    kSelectingSource,
+    kSelectingDestination,
+    kSelectingSupposition,
+  };
+
   void HighlightPlaceableSquares(const Point &src) const;
   Graphic * const graphic() const { return graphic_; }
 
   Graphic * const graphic_;
+  State state_;
+  // Being selected.
+  Move move_;
 };
 
 #endif  // GUNJIN_SHOGI_PLAYER_H_
\ No newline at end of file
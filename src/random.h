@@ -0,0 +1,37 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016 Hirotaka Nagashima. All rights reserved.
+//-----------------------------------------------------------------------------
+// This class generates random numbers by xorshift64*.
+// Unlike rand(), each game has its own state, which can be saved.
+//-----------------------------------------------------------------------------
+
+#ifndef GUNJIN_SHOGI_RANDOM_H_
+#define GUNJIN_SHOGI_RANDOM_H_
+
+#include <cstdint>
+
+class Random {
+public:
+  Random() : state_(kDefaultState) {}
+
+  void Seed(uint64_t seed) { state_ = (seed != 0) ? seed : kDefaultState; }
+  uint64_t Next() {
+    state_ ^= state_ >> 12;
+    state_ ^= state_ << 25;
+    state_ ^= state_ >> 27;
+    return state_ * 0x2545f4914f6cdd1dULL;
+  }
+  // Returns a number in [0, n).
+  int Next(int n) { return static_cast<int>((Next() >> 33) % n); }
+
+  uint64_t state() const { return state_; }
+  void set_state(uint64_t state) { Seed(state); }
+
+private:
+  // The state must not be zero.
+  static const uint64_t kDefaultState = 0x853c49e6748fea9bULL;
+
+  uint64_t state_;
+};
+
+#endif  // GUNJIN_SHOGI_RANDOM_H_
\ No newline at end of file
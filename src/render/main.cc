@@ -0,0 +1,145 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016 Hirotaka Nagashima. All rights reserved.
+//-----------------------------------------------------------------------------
+// Renders replays into png files without a window.
+// Usage: gunjin-render [-j <number of workers>] [-p <0|1>]
+//                      <output directory> <replay files...>
+// Each ply of "x.replay" is saved as "x-<ply>.png", seen from the
+// character given by "-p".
+//-----------------------------------------------------------------------------
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../board.h"
+#include "../character.h"
+#include "../graphic.h"
+#include "../replay.h"
+
+namespace {
+
+// A character who only shows the board.
+class Viewer : public Character {
+public:
+  Viewer(Board *board, int id, const std::string &name)
+      : Character(kPlayer, board, id, name) {}
+
+  Move MovePiece() { return Move(); }
+  void ReplacePieces() {}
+};
+
+// Opening fonts isn't thread-safe.
+std::mutex initialization_mutex;
+
+// Returns "dir/x" for "path/x.replay".
+std::string ToFramePrefix(const std::string &directory,
+                          const std::string &path) {
+  std::string name = path.substr(path.find_last_of("/\\") + 1);
+  size_t extension = name.rfind(".replay");
+  if (extension != std::string::npos)
+    name.erase(extension);
+  return directory + "/" + name;
+}
+
+bool Render(Graphic *graphic, int characters_id, const std::string &path,
+            const std::string &prefix) {
+  Replay replay;
+  if (!replay.Load(path.c_str())) {
+    fprintf(stderr, "ERROR: %s is unavailable.\n", path.c_str());
+    return false;
+  }
+
+  // Draw each ply with the move hilighted.
+  Board board;
+  Viewer viewer(&board, characters_id, characters_id == 0 ? "Player1" :
+                                                            "Player2");
+  for (int ply = 0; ply <= replay.num_plies(); ++ply) {
+    replay.Seek(ply, &board);
+    viewer.UpdateScore();
+    graphic->DisplayBoard(board, viewer);
+    if (0 < ply) {
+      Move move = replay.move(ply);
+      graphic->HilightSquare(move.src, characters_id);
+      graphic->HilightSquare(move.dest, characters_id);
+    }
+
+    char file_name[32];
+    snprintf(file_name, sizeof(file_name), "-%04d.png", ply);
+    if (!graphic->SaveFrame((prefix + file_name).c_str())) {
+      fprintf(stderr, "ERROR: %s%s can't be saved.\n", prefix.c_str(),
+              file_name);
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  // Parse arguments.
+  int num_workers = static_cast<int>(std::thread::hardware_concurrency());
+  int characters_id = 0;
+  int arg = 1;
+  for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2) {
+    if (strcmp(argv[arg], "-j") == 0)
+      num_workers = atoi(argv[arg + 1]);
+    else if (strcmp(argv[arg], "-p") == 0)
+      characters_id = atoi(argv[arg + 1]) == 1 ? 1 : 0;
+  }
+  if (argc - arg < 2) {
+    fprintf(stderr, "Usage: %s [-j <number of workers>] [-p <0|1>] "
+            "<output directory> <replay files...>\n", argv[0]);
+    return -1;
+  }
+  if (num_workers <= 0)
+    num_workers = 1;
+  const std::string kDirectory = argv[arg++];
+  std::vector<std::string> paths(argv + arg, argv + argc);
+
+  // Use no window.
+  SDL_SetHint(SDL_HINT_VIDEODRIVER, "dummy");
+  if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+    fprintf(stderr, "ERROR: %s\n", SDL_GetError());
+    return -1;
+  }
+  if (TTF_Init() < 0) {
+    fprintf(stderr, "ERROR: %s\n", TTF_GetError());
+    return -1;
+  }
+  IMG_Init(IMG_INIT_PNG);
+
+  // Each worker has a graphic and takes replays in order.
+  std::atomic<int> next_id(0);
+  std::atomic<int> num_failures(0);
+  std::vector<std::thread> workers;
+  for (int i = 0; i < num_workers; ++i) {
+    workers.push_back(std::thread([&]() {
+      Graphic graphic;
+      {
+        std::lock_guard<std::mutex> lock(initialization_mutex);
+        graphic.Initialize(true);
+      }
+      int id;
+      while ((id = next_id++) < static_cast<int>(paths.size())) {
+        if (!Render(&graphic, characters_id, paths[id],
+                    ToFramePrefix(kDirectory, paths[id])))
+          ++num_failures;
+      }
+      std::lock_guard<std::mutex> lock(initialization_mutex);
+      graphic.Terminate();
+    }));
+  }
+  for (int i = 0; i < num_workers; ++i)
+    workers[i].join();
+
+  IMG_Quit();
+  TTF_Quit();
+  SDL_Quit();
+  return (num_failures == 0) ? 0 : -1;
+}
\ No newline at end of file
@@ -0,0 +1,129 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016 Hirotaka Nagashima. All rights reserved.
+//-----------------------------------------------------------------------------
+// Information on this class is described in "replay.h".
+//-----------------------------------------------------------------------------
+
+#include "replay.h"
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+const char kMagic[4] = {'G', 'J', 'R', 'P'};
+
+}  // namespace
+
+void Replay::Start(const Board &board) {
+  keyframes_.clear();
+  deltas_.clear();
+  memcpy(last_.squares, board.squares(), sizeof(last_.squares));
+  keyframes_.push_back(last_);
+}
+
+void Replay::Record(const Board &board) {
+  // Keep pieces of the move including suppositions.
+  Delta delta;
+  delta.move = board.prev_move();
+  delta.src_piece = board.board(delta.move.src);
+  delta.dest_piece = board.board(delta.move.dest);
+  deltas_.push_back(delta);
+  Apply(delta, &last_.squares);
+
+  // Add a keyframe.
+  if (num_plies() % kKeyframeInterval == 0)
+    keyframes_.push_back(last_);
+}
+
+bool Replay::Seek(int ply, Board *board) const {
+  if (!is_started() || ply < 0 || num_plies() < ply)
+    return false;
+
+  // Apply deltas after the nearest keyframe.
+  int keyframe_id = ply / kKeyframeInterval;
+  Keyframe keyframe = keyframes_[keyframe_id];
+  for (int i = keyframe_id * kKeyframeInterval; i < ply; ++i)
+    Apply(deltas_[i], &keyframe.squares);
+  board->Load(keyframe.squares);
+  return true;
+}
+
+bool Replay::Save(const char *file_name) const {
+  FILE *file = fopen(file_name, "wb");
+  if (!file)
+    return false;
+
+  // Write the first board and the deltas.
+  int num = num_plies();
+  bool is_written =
+      (fwrite(kMagic, sizeof(kMagic), 1, file) == 1 &&
+       fwrite(&num, sizeof(num), 1, file) == 1 &&
+       fwrite(&keyframes_[0], sizeof(keyframes_[0]), 1, file) == 1 &&
+       (num == 0 ||
+        fwrite(&deltas_[0], sizeof(deltas_[0]), num, file) ==
+        static_cast<size_t>(num)));
+
+  fclose(file);
+  return is_written;
+}
+
+bool Replay::Load(const char *file_name) {
+  FILE *file = fopen(file_name, "rb");
+  if (!file)
+    return false;
+
+  // Read the first board.
+  char magic[sizeof(kMagic)];
+  int num = 0;
+  Keyframe first;
+  bool is_read =
+      (fread(magic, sizeof(magic), 1, file) == 1 &&
+       memcmp(magic, kMagic, sizeof(kMagic)) == 0 &&
+       fread(&num, sizeof(num), 1, file) == 1 &&
+       0 <= num && num < Board::kMaxNumLogs &&
+       fread(&first, sizeof(first), 1, file) == 1 &&
+       Board::IsLoadable(first.squares));
+
+  // Read the deltas and make keyframes again. A delta must not move
+  // dummy headquarters.
+  std::vector<Delta> deltas(num);
+  is_read = is_read &&
+      (num == 0 ||
+       fread(&deltas[0], sizeof(deltas[0]), num, file) ==
+       static_cast<size_t>(num));
+  fclose(file);
+  for (int i = 0; i < num && is_read; ++i) {
+    const Delta &kDelta = deltas[i];
+    is_read = (Board::IsInside(kDelta.move.src) &&
+               Board::IsInside(kDelta.move.dest) &&
+               kDelta.src_piece.IsValid() && kDelta.dest_piece.IsValid() &&
+               kDelta.src_piece.piece != Board::Piece::kDummyHeadquarters &&
+               kDelta.dest_piece.piece != Board::Piece::kDummyHeadquarters);
+  }
+  if (!is_read)
+    return false;
+
+  keyframes_.clear();
+  deltas_.clear();
+  last_ = first;
+  keyframes_.push_back(last_);
+  for (int i = 0; i < num; ++i) {
+    deltas_.push_back(deltas[i]);
+    Apply(deltas[i], &last_.squares);
+    if (num_plies() % kKeyframeInterval == 0)
+      keyframes_.push_back(last_);
+  }
+  return true;
+}
+
+void Replay::Apply(const Delta &delta, Board::Squares *squares) const {
+  // Write raw squares, in which a headquarters is at the left one.
+  const Point kPoints[] = {delta.move.src, delta.move.dest};
+  const Board::Piece kPieces[] = {delta.src_piece, delta.dest_piece};
+  for (int i = 0; i < 2; ++i) {
+    Point p = kPoints[i];
+    if ((*squares)[p.y][p.x].piece == Board::Piece::kDummyHeadquarters)
+      --p.x;
+    (*squares)[p.y][p.x] = kPieces[i];
+  }
+}
\ No newline at end of file
@@ -0,0 +1,57 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016 Hirotaka Nagashima. All rights reserved.
+//-----------------------------------------------------------------------------
+// This class records a game to view any ply of it later.
+// Every "kKeyframeInterval" plies all squares are kept as a keyframe,
+// and each ply keeps only the squares it changed. So seeking applies
+// less than "kKeyframeInterval" plies to a keyframe.
+//-----------------------------------------------------------------------------
+
+#ifndef GUNJIN_SHOGI_REPLAY_H_
+#define GUNJIN_SHOGI_REPLAY_H_
+
+#include <vector>
+#include "board.h"
+#include "point.h"
+
+class Replay {
+public:
+  static const int kKeyframeInterval = 16;
+
+  Replay() {}
+
+  // Records the board before the first move.
+  void Start(const Board &board);
+  // Records the board after a move.
+  void Record(const Board &board);
+  // Sets the board after "ply" moves. Returns false and leaves the board
+  // if "ply" is out of 0 to "num_plies()".
+  bool Seek(int ply, Board *board) const;
+  // Binary files with the first board and changed squares of each ply.
+  bool Save(const char *file_name) const;
+  // Returns false if a square or a delta is out of range.
+  bool Load(const char *file_name);
+
+  int num_plies() const { return static_cast<int>(deltas_.size()); }
+  // The move of the "ply"th move.
+  Move move(int ply) const { return deltas_[ply - 1].move; }
+  bool is_started() const { return !keyframes_.empty(); }
+
+private:
+  struct Keyframe {
+    Board::Squares squares;
+  };
+  struct Delta {
+    Move move;
+    Board::Piece src_piece, dest_piece;
+  };
+
+  void Apply(const Delta &delta, Board::Squares *squares) const;
+
+  std::vector<Keyframe> keyframes_;
+  std::vector<Delta> deltas_;
+  // The squares of the last ply.
+  Keyframe last_;
+};
+
+#endif  // GUNJIN_SHOGI_REPLAY_H_
\ No newline at end of file
@@ -0,0 +1,49 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016 Hirotaka Nagashima. All rights reserved.
+//-----------------------------------------------------------------------------
+// Information on this class is described in "resources.h".
+//-----------------------------------------------------------------------------
+
+#include "resources.h"
+#include <cstdio>
+#include <cstring>
+
+#ifdef EMBED_RESOURCES
+// Defined in "resources/embedded.cc".
+extern const Resources::Embedded kEmbeddedResources[];
+extern const int kNumEmbeddedResources;
+#else
+const Resources::Embedded *const kEmbeddedResources = nullptr;
+const int kNumEmbeddedResources = 0;
+#endif
+
+const char *Resources::kDirectory = "src/resources";
+
+const Resources::Embedded *Resources::FindEmbedded(const char *name) {
+  for (int i = 0; i < kNumEmbeddedResources; ++i) {
+    if (strcmp(kEmbeddedResources[i].name, name) == 0)
+      return &kEmbeddedResources[i];
+  }
+  return nullptr;
+}
+
+bool Resources::Read(const char *name, std::string *data) {
+  const Embedded *embedded = FindEmbedded(name);
+  if (embedded) {
+    data->assign(reinterpret_cast<const char *>(embedded->data),
+                 embedded->size);
+    return true;
+  }
+
+  // Read the whole file.
+  FILE *file = fopen(ToPath(name).c_str(), "rb");
+  if (!file)
+    return false;
+  data->clear();
+  char buffer[4096];
+  size_t size;
+  while ((size = fread(buffer, 1, sizeof(buffer), file)) != 0)
+    data->append(buffer, size);
+  fclose(file);
+  return true;
+}
\ No newline at end of file
@@ -0,0 +1,34 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016 Hirotaka Nagashima. All rights reserved.
+//-----------------------------------------------------------------------------
+// This class finds resources such as images and formations.
+// They are compiled into binaries by "make EMBED=1", which generates
+// "resources/embedded.cc" with "gunjin-embed". Otherwise they are read
+// from files in "kDirectory".
+//-----------------------------------------------------------------------------
+
+#ifndef GUNJIN_SHOGI_RESOURCES_H_
+#define GUNJIN_SHOGI_RESOURCES_H_
+
+#include <string>
+
+class Resources {
+public:
+  struct Embedded {
+    const char *name;
+    const unsigned char *data;
+    int size;
+  };
+
+  static const char *kDirectory;
+
+  // Returns nullptr if "name" is not embedded.
+  static const Embedded *FindEmbedded(const char *name);
+  // Reads an embedded resource or a file. Returns false if not found.
+  static bool Read(const char *name, std::string *data);
+  static std::string ToPath(const char *name) {
+    return std::string(kDirectory) + "/" + name;
+  }
+};
+
+#endif  // GUNJIN_SHOGI_RESOURCES_H_
\ No newline at end of file
@@ -0,0 +1,700 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016 Hirotaka Nagashima. All rights reserved.
+//-----------------------------------------------------------------------------
+// Information on this class is described in "server.h".
+//-----------------------------------------------------------------------------
+
+#include "server.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <sstream>
+#include "ai.h"
+#include "board.h"
+#include "character.h"
+#include "feed.h"
+#include "match.h"
+#include "point.h"
+#include "replay.h"
+#include "snapshot.h"
+
+namespace {
+
+const int kPlayersId = 0;
+const int kAisId = 1;
+
+// Returns the result of the previous battle seen from the moved piece.
+char GetPrevResult(const Board &board) {
+  Board::Piece dest = board.board(board.prev_move().dest);
+  if (!dest.IsPiece())
+    return 'd';
+  if (dest.characters_id == board.prev_src_piece().characters_id)
+    return 'w';
+  return 'l';
+}
+
+// Returns squares seen by the player.
+std::string ToString(const Board &board) {
+  std::ostringstream text;
+  Point p;
+  for (p.y = 0; p.y < Board::kHeight; ++p.y) {
+    for (p.x = 0; p.x < Board::kWidth; ++p.x) {
+      Board::Piece piece = board.board(p);
+      if (0 < p.y || 0 < p.x)
+        text << " ";
+      if (!piece.IsPiece())
+        text << ".";
+      else if (piece.characters_id != kPlayersId)
+        text << "?";
+      else
+        text << piece.piece;
+    }
+  }
+  return text.str();
+}
+
+std::string ToString(const Move &move) {
+  std::ostringstream text;
+  text << move.src.y << " " << move.src.x << " " <<
+      move.dest.y << " " << move.dest.x;
+  return text.str();
+}
+
+// A player who sends moves through a session.
+class RemotePlayer : public Character {
+public:
+  RemotePlayer(Board *board, int id)
+      : Character(kPlayer, board, id, "Player"),
+        has_move_(false) {}
+
+  // Pieces are placed randomly.
+  void ReplacePieces() {}
+  Move MovePiece() {
+    Move move;
+    ResumeMovePiece(&move);
+    return move;
+  }
+  TurnStatus ResumeMovePiece(Move *move) {
+    if (!has_move_)
+      return kWaiting;
+    has_move_ = false;
+    board()->Battle(move_);
+    *move = move_;
+    return kDone;
+  }
+
+  // Resumes "ResumeMovePiece()" with a valid move.
+  void set_move(const Move &move) {
+    move_ = move;
+    has_move_ = true;
+  }
+
+private:
+  bool has_move_;
+  Move move_;
+};
+
+}  // namespace
+
+// Games are allocated only while playing to keep idle sessions small.
+struct Server::Session {
+  Session(int fd)
+      : fd(fd), board(nullptr), player(nullptr), ai(nullptr), match(nullptr),
+        feed(nullptr), replay(nullptr), game_id(0), watched(nullptr),
+        perspective(Feed::kPublic), ai_is_thinking(false), is_closed(false) {}
+  ~Session() {
+    delete replay;
+    delete feed;
+    delete match;
+    delete ai;
+    delete player;
+    delete board;
+  }
+
+  int fd;
+  std::string input;
+  std::string output;
+  Board *board;
+  RemotePlayer *player;
+  Ai *ai;
+  Match *match;
+  Feed *feed;
+  Replay *replay;
+  int game_id;
+  std::vector<Session *> spectators;
+  // The session playing the game which this session watches.
+  Session *watched;
+  Feed::Perspective perspective;
+  bool ai_is_thinking;
+  // Closed while the ai is thinking.
+  bool is_closed;
+};
+
+Server::Server(int num_workers)
+    : epoll_fd_(epoll_create1(0)),
+      listen_fd_(-1),
+      event_fd_(eventfd(0, EFD_NONBLOCK)),
+      is_stopped_(false),
+      num_sessions_(0),
+      num_games_(0),
+      scheduler_(nullptr) {
+  Ai::SearchLimits limits = {0, 0, 0};
+  scheduler_ = new AiScheduler(num_workers, limits);
+
+  // Reset random seed randomly.
+  random_.Seed(static_cast<uint64_t>(time(NULL)));
+
+  epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.fd = event_fd_;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, event_fd_, &event);
+}
+
+Server::~Server() {
+  delete scheduler_;
+  for (int i = 0; i < static_cast<int>(sessions_.size()); ++i) {
+    if (sessions_[i]) {
+      close(sessions_[i]->fd);
+      delete sessions_[i];
+    }
+  }
+  for (int i = 0; i < static_cast<int>(finished_sessions_.size()); ++i) {
+    if (finished_sessions_[i]->is_closed)
+      delete finished_sessions_[i];
+  }
+  if (0 <= listen_fd_)
+    close(listen_fd_);
+  close(event_fd_);
+  close(epoll_fd_);
+}
+
+bool Server::ListenTcp(int port) {
+  int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  int reuse = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0) {
+    perror("ERROR");
+    close(fd);
+    return false;
+  }
+  return Listen(fd);
+}
+
+bool Server::ListenUnix(const std::string &path) {
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  sockaddr_un address = {};
+  address.sun_family = AF_UNIX;
+  strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+  unlink(path.c_str());
+  if (bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0) {
+    perror("ERROR");
+    close(fd);
+    return false;
+  }
+  return Listen(fd);
+}
+
+bool Server::Listen(int fd) {
+  if (listen(fd, SOMAXCONN) < 0) {
+    perror("ERROR");
+    close(fd);
+    return false;
+  }
+  listen_fd_ = fd;
+
+  epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.fd = listen_fd_;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fd_, &event);
+  return true;
+}
+
+void Server::Run() {
+  epoll_event events[kMaxNumEvents];
+  while (!is_stopped_) {
+    int num_events = epoll_wait(epoll_fd_, events, kMaxNumEvents, -1);
+    for (int i = 0; i < num_events; ++i) {
+      int fd = events[i].data.fd;
+      if (fd == listen_fd_) {
+        Accept();
+      } else if (fd == event_fd_) {
+        // Finish turns of the ai.
+        uint64_t count;
+        while (read(event_fd_, &count, sizeof(count)) == sizeof(count)) {}
+        std::vector<Session *> finished_sessions;
+        {
+          std::lock_guard<std::mutex> lock(finished_mutex_);
+          finished_sessions.swap(finished_sessions_);
+        }
+        for (int j = 0; j < static_cast<int>(finished_sessions.size()); ++j)
+          FinishAisTurn(finished_sessions[j]);
+      } else if (fd < static_cast<int>(sessions_.size()) && sessions_[fd]) {
+        Session *session = sessions_[fd];
+        if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+          Read(session);
+        if (sessions_[fd] == session && (events[i].events & EPOLLOUT))
+          Write(session);
+      }
+    }
+  }
+}
+
+void Server::Stop() {
+  is_stopped_ = true;
+  uint64_t count = 1;
+  if (write(event_fd_, &count, sizeof(count)) < 0)
+    perror("ERROR");
+}
+
+void Server::Accept() {
+  while (true) {
+    int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK);
+    if (fd < 0)
+      return;
+
+    // Register a new session.
+    if (static_cast<int>(sessions_.size()) <= fd)
+      sessions_.resize(fd + 1, nullptr);
+    sessions_[fd] = new Session(fd);
+    ++num_sessions_;
+
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event);
+  }
+}
+
+void Server::Read(Session *session) {
+  // Read all available data. Lines sent before the end of the input are
+  // executed before the session is closed.
+  char buffer[4096];
+  bool input_is_ended = false;
+  while (true) {
+    ssize_t size = read(session->fd, buffer, sizeof(buffer));
+    if (size == 0 || (size < 0 && errno != EAGAIN && errno != EINTR)) {
+      input_is_ended = true;
+      break;
+    }
+    if (size < 0) {
+      if (errno == EINTR)
+        continue;
+      break;
+    }
+    session->input.append(buffer, size);
+  }
+
+  // Execute each line.
+  size_t begin = 0, end;
+  while ((end = session->input.find('\n', begin)) != std::string::npos) {
+    std::string line = session->input.substr(begin, end - begin);
+    if (!line.empty() && line[line.size() - 1] == '\r')
+      line.erase(line.size() - 1);
+    begin = end + 1;
+    if (!Execute(session, line)) {
+      Write(session);
+      Close(session);
+      return;
+    }
+  }
+  session->input.erase(0, begin);
+  if (input_is_ended) {
+    Write(session);
+    Close(session);
+  } else if (kMaxLengthLine < static_cast<int>(session->input.size())) {
+    Close(session);
+  }
+}
+
+void Server::Write(Session *session) {
+  while (!session->output.empty()) {
+    ssize_t size = send(session->fd, session->output.data(),
+                        session->output.size(), MSG_NOSIGNAL);
+    if (size < 0) {
+      if (errno == EINTR)
+        continue;
+      // Let "Read()" close the broken session.
+      if (errno != EAGAIN) {
+        session->output.clear();
+        shutdown(session->fd, SHUT_RDWR);
+      }
+      break;
+    }
+    session->output.erase(0, size);
+  }
+  UpdateEvents(session);
+}
+
+bool Server::Execute(Session *session, const std::string &line) {
+  std::istringstream args(line);
+  std::string command;
+  if (!(args >> command))
+    return true;
+
+  if (command == "quit") {
+    return false;
+  } else if (command == "watch") {
+    std::string rest;
+    std::getline(args, rest);
+    Watch(session, rest);
+  } else if (command == "unwatch") {
+    Unwatch(session);
+  } else if (session->ai_is_thinking) {
+    Send(session, "error not your turn");
+  } else if (command == "newgame") {
+    std::string name;
+    Ai::Level level = Ai::kNormal;
+    if (args >> name && !Ai::ParseLevel(name, &level))
+      Send(session, "error unknown level " + name);
+    else
+      NewGame(session, level);
+  } else if (command == "move") {
+    std::string rest;
+    std::getline(args, rest);
+    MovePlayersPiece(session, rest);
+  } else if (command == "save") {
+    SaveGame(session);
+  } else if (command == "restore") {
+    std::string hex;
+    args >> hex;
+    RestoreGame(session, hex);
+  } else if (command == "stats") {
+    SendStatistics(session);
+  } else {
+    Send(session, "error unknown command " + command);
+  }
+
+  return true;
+}
+
+void Server::CreateGame(Session *session, Ai::Level level) {
+  EndGame(session);
+  Unwatch(session);
+  session->board = new Board;
+  session->player = new RemotePlayer(session->board, kPlayersId);
+  session->ai = new Ai(session->board, kAisId, "Computer");
+  session->ai->set_level(level);
+  session->ai->set_scheduler(scheduler_, kAiDeadlineMilliseconds,
+                             [this, session]() { NotifyAisTurn(session); });
+  session->match = new Match(session->board, session->player, session->ai);
+  session->feed = new Feed;
+  session->replay = new Replay;
+  session->game_id = ++num_games_;
+  games_[session->game_id] = session;
+}
+
+void Server::NewGame(Session *session, Ai::Level level) {
+  CreateGame(session, level);
+
+  // Pieces of the player are placed randomly.
+  session->board->random().Seed(random_.Next());
+  session->board->Initialize();
+  Send(session, "game " + std::to_string(session->game_id));
+  ResumeGame(session);
+}
+
+void Server::SaveGame(Session *session) {
+  if (!session->match) {
+    Send(session, "error no game");
+    return;
+  }
+
+  // Convert bytes into hex.
+  static const char kDigits[] = "0123456789abcdef";
+  std::string bytes;
+  Snapshot::Save(*session->match, &bytes);
+  std::string text = "snapshot ";
+  for (int i = 0; i < static_cast<int>(bytes.size()); ++i) {
+    text += kDigits[(bytes[i] >> 4) & 0xf];
+    text += kDigits[bytes[i] & 0xf];
+  }
+  Send(session, text);
+}
+
+void Server::RestoreGame(Session *session, const std::string &hex) {
+  // Convert hex into bytes.
+  std::string bytes(hex.size() / 2, '\0');
+  for (int i = 0; i < static_cast<int>(bytes.size()); ++i) {
+    int byte;
+    if (sscanf(hex.c_str() + i * 2, "%2x", &byte) != 1) {
+      Send(session, "error wrong snapshot");
+      return;
+    }
+    bytes[i] = static_cast<char>(byte);
+  }
+
+  CreateGame(session, Ai::kNormal);
+  if (!Snapshot::Restore(bytes, session->match)) {
+    EndGame(session);
+    Send(session, "error wrong snapshot");
+    return;
+  }
+
+  Send(session, "game " + std::to_string(session->game_id));
+  if (session->match->phase() == Match::kMoving)
+    session->replay->Start(*session->board);
+
+  // The turn of the player started before it was saved.
+  if (session->match->phase() == Match::kMoving &&
+      session->match->turn() == kPlayersId) {
+    Send(session, "board " + ToString(*session->board));
+    Send(session, "turn you");
+  }
+  ResumeGame(session);
+}
+
+void Server::MovePlayersPiece(Session *session, const std::string &args) {
+  Board *board = session->board;
+  if (!board) {
+    Send(session, "error no game");
+    return;
+  }
+
+  // Check the move.
+  Move move;
+  std::istringstream stream(args);
+  if (!(stream >> move.src.y >> move.src.x >> move.dest.y >> move.dest.x) ||
+      move.src.y < 0 || Board::kHeight <= move.src.y ||
+      move.src.x < 0 || Board::kWidth <= move.src.x ||
+      move.dest.y < 0 || Board::kHeight <= move.dest.y ||
+      move.dest.x < 0 || Board::kWidth <= move.dest.x ||
+      board->board(move.src).characters_id != kPlayersId ||
+      !board->IsMoveValid(move)) {
+    Send(session, "error wrong move");
+    return;
+  }
+
+  session->player->set_move(move);
+  ResumeGame(session);
+}
+
+void Server::SendStatistics(Session *session) {
+  AiScheduler::Statistics statistics = scheduler_->statistics();
+  int num_requests = std::max(1, statistics.num_requests);
+  std::ostringstream text;
+  text << "stats requests " << statistics.num_requests <<
+      " late " << statistics.num_late_requests <<
+      " queue " << statistics.sum_queueing_microseconds / num_requests <<
+      " " << statistics.max_queueing_microseconds <<
+      " compute " << statistics.sum_computing_microseconds / num_requests <<
+      " " << statistics.max_computing_microseconds;
+  Send(session, text.str());
+}
+
+void Server::Watch(Session *session, const std::string &args) {
+  // Check the game.
+  std::istringstream stream(args);
+  int game_id, characters_id = Feed::kPublic;
+  if (!(stream >> game_id)) {
+    Send(session, "error no game");
+    return;
+  }
+  stream >> characters_id;
+  std::unordered_map<int, Session *>::iterator game = games_.find(game_id);
+  if (game == games_.end() || game->second == session ||
+      characters_id < 0 || Feed::kPublic < characters_id) {
+    Send(session, "error no game");
+    return;
+  }
+  if (session->match) {
+    Send(session, "error playing");
+    return;
+  }
+
+  // Join with all squares. A feed follows every ply once pieces move, and
+  // no ai searches on the board before.
+  Unwatch(session);
+  Session *watched = game->second;
+  if (!watched->feed->is_started())
+    watched->feed->Update(*watched->board);
+  watched->spectators.push_back(session);
+  session->watched = watched;
+  session->perspective = static_cast<Feed::Perspective>(characters_id);
+  Send(session, watched->feed->Sync(session->perspective));
+}
+
+void Server::Unwatch(Session *session) {
+  Session *watched = session->watched;
+  if (!watched)
+    return;
+  std::vector<Session *> &spectators = watched->spectators;
+  spectators.erase(std::find(spectators.begin(), spectators.end(), session));
+  session->watched = nullptr;
+}
+
+void Server::Broadcast(Session *session) {
+  // Messages are made once for each perspective.
+  session->feed->Update(*session->board);
+  for (int i = 0; i < static_cast<int>(session->spectators.size()); ++i) {
+    Session *spectator = session->spectators[i];
+    Send(spectator, session->feed->message(spectator->perspective));
+  }
+}
+
+void Server::ReleaseSpectators(Session *session, const std::string &text) {
+  for (int i = 0; i < static_cast<int>(session->spectators.size()); ++i) {
+    Session *spectator = session->spectators[i];
+    spectator->watched = nullptr;
+    Send(spectator, text);
+  }
+  session->spectators.clear();
+}
+
+void Server::NotifyAisTurn(Session *session) {
+  {
+    std::lock_guard<std::mutex> lock(finished_mutex_);
+    finished_sessions_.push_back(session);
+  }
+  uint64_t count = 1;
+  if (write(event_fd_, &count, sizeof(count)) < 0)
+    perror("ERROR");
+}
+
+void Server::FinishAisTurn(Session *session) {
+  session->ai_is_thinking = false;
+  if (session->is_closed) {
+    delete session;
+    return;
+  }
+  ResumeGame(session);
+}
+
+void Server::ResumeGame(Session *session) {
+  Board *board = session->board;
+  while (true) {
+    Match::Event event = session->match->Resume();
+    bool is_players_turn = (session->match->turn() == kPlayersId);
+    bool is_moving = (session->match->phase() == Match::kMoving);
+
+    switch (event) {
+    case Match::kWaiting: {
+      // Resumed by "set_move()" or "FinishAisTurn()".
+      session->ai_is_thinking = !is_players_turn;
+      return;
+    }
+    case Match::kTurnStarted: {
+      if (is_moving && !session->replay->is_started()) {
+        session->replay->Start(*board);
+        session->feed->Update(*board);
+      }
+      if (is_moving && is_players_turn) {
+        Send(session, "board " + ToString(*board));
+        Send(session, "turn you");
+      }
+      break;
+    }
+    case Match::kTurnEnded: {
+      if (!is_moving)
+        break;
+      session->replay->Record(*board);
+      Send(session, "move " + ToString(board->prev_move()) + " " +
+           GetPrevResult(*board));
+      Broadcast(session);
+      if (!is_players_turn) {
+        std::ostringstream info;
+        info << "info queue " << session->ai->queueing_microseconds() <<
+            " compute " << session->ai->computing_microseconds() <<
+            " nodes " << session->ai->search_info().num_nodes <<
+            " qnodes " << session->ai->search_info().num_quiescence_nodes;
+        Send(session, info.str());
+      }
+      break;
+    }
+    default: {
+      if (session->match->game_was_drawn()) {
+        Send(session, "end draw");
+        ReleaseSpectators(session, "end draw");
+      } else {
+        Send(session, (session->match->winners_id() == kPlayersId) ?
+             "end win" : "end lose");
+        ReleaseSpectators(session, "end " + std::to_string(
+            session->match->winners_id()));
+      }
+      SaveReplay(session);
+      EndGame(session);
+      return;
+    }
+    }
+  }
+}
+
+void Server::SaveReplay(Session *session) {
+  if (replay_directory_.empty())
+    return;
+  char file_name[64];
+  snprintf(file_name, sizeof(file_name), "/%ld-%d.replay",
+           static_cast<long>(time(NULL)), session->game_id);
+  if (!session->replay->Save((replay_directory_ + file_name).c_str()))
+    fprintf(stderr, "ERROR: %s%s can't be saved.\n",
+            replay_directory_.c_str(), file_name);
+}
+
+void Server::EndGame(Session *session) {
+  UnregisterGame(session);
+  delete session->replay;
+  delete session->feed;
+  delete session->match;
+  delete session->ai;
+  delete session->player;
+  delete session->board;
+  session->match = nullptr;
+  session->ai = nullptr;
+  session->player = nullptr;
+  session->board = nullptr;
+  session->feed = nullptr;
+  session->replay = nullptr;
+}
+
+void Server::UnregisterGame(Session *session) {
+  if (!session->match)
+    return;
+  ReleaseSpectators(session, "end aborted");
+  games_.erase(session->game_id);
+}
+
+void Server::Send(Session *session, const std::string &text) {
+  bool was_empty = session->output.empty();
+  session->output += text;
+  session->output += '\n';
+  if (was_empty)
+    Write(session);
+}
+
+void Server::UpdateEvents(Session *session) {
+  epoll_event event = {};
+  event.events = EPOLLIN;
+  if (!session->output.empty())
+    event.events |= EPOLLOUT;
+  event.data.fd = session->fd;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, session->fd, &event);
+}
+
+void Server::Close(Session *session) {
+  if (sessions_[session->fd] != session)
+    return;
+  sessions_[session->fd] = nullptr;
+  --num_sessions_;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, session->fd, nullptr);
+  Unwatch(session);
+  UnregisterGame(session);
+
+  // A worker may be moving a piece of the ai with the session.
+  close(session->fd);
+  if (session->ai_is_thinking)
+    session->is_closed = true;
+  else
+    delete session;
+}
\ No newline at end of file
@@ -0,0 +1,131 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016 Hirotaka Nagashima. All rights reserved.
+//-----------------------------------------------------------------------------
+// This class hosts many games of remote players against the ai in one
+// thread with epoll. Turns of the ai are run by a scheduler.
+//
+// Each connection is a session which talks lines of text.
+// A board is seen as in "Board", and a move is "sy sx dy dx".
+//   newgame [<level>]    -> "game <id>", "board <squares>", "turn you"
+//     Starts a game as the character 0 with random formations against
+//     the ai of a level, "beginner", "easy", "normal" or "hard".
+//     A move of the ai takes the time of the level at most.
+//     <squares> are 48 of the kinds of the player's pieces,
+//     "?" for the opponent's pieces and "." for empty squares.
+//   move <move>          -> "move <move> <w|l|d>"
+//     Moves a piece of the player. Then the ai moves, which is answered
+//     with "move <move> <w|l|d>", "board <squares>" and "turn you".
+//   save                 -> "snapshot <hex>"
+//     Saves the game in "Snapshot" to continue it on any server.
+//   restore <hex>        -> "game <id>", "board <squares>", "turn you"
+//     Continues a saved game against the ai of "normal".
+//   watch <id> [0|1]     -> "sync <ply> <squares>"
+//     Watches a game from the perspective of a character, or with all
+//     pieces hidden. Messages of "Feed" are sent after each battle,
+//     and "end <0|1|draw|aborted>" is sent when the game ends.
+//   unwatch
+//   stats                -> "stats requests <n> late <n>
+//                            queue <average> <max> compute <average> <max>"
+//     Shows statistics of the scheduler in microseconds.
+//   quit
+// Finished games are saved as "Replay" files if a directory is set.
+// "info queue <us> compute <us> nodes <n> qnodes <n>" is sent after the ai
+// moved, and "end <win|lose|draw>" is sent when a game ends.
+// A wrong command is answered with "error <message>".
+//-----------------------------------------------------------------------------
+
+#ifndef GUNJIN_SHOGI_SERVER_H_
+#define GUNJIN_SHOGI_SERVER_H_
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "ai_scheduler.h"
+#include "random.h"
+
+class Server {
+public:
+  explicit Server(int num_workers);
+  ~Server();
+
+  // Listens on a port of the loopback address.
+  bool ListenTcp(int port);
+  // Listens on a unix domain socket.
+  bool ListenUnix(const std::string &path);
+  // Serves till "Stop()" is called.
+  void Run();
+  // Replays are saved as "<directory>/<time>-<id>.replay".
+  void set_replay_directory(const std::string &directory) {
+    replay_directory_ = directory;
+  }
+  // Thread-safe.
+  void Stop();
+
+  int num_sessions() const { return num_sessions_; }
+
+private:
+  struct Session;
+
+  // Long enough for a snapshot in hex.
+  static const int kMaxLengthLine = 32768;
+  // The ai must move within this.
+  static const int kAiDeadlineMilliseconds = 1000;
+  static const int kMaxNumEvents = 256;
+
+  bool Listen(int fd);
+  void Accept();
+  void Read(Session *session);
+  void Write(Session *session);
+  // Returns false if the session should be closed.
+  bool Execute(Session *session, const std::string &line);
+  void CreateGame(Session *session, Ai::Level level);
+  void NewGame(Session *session, Ai::Level level);
+  void SaveGame(Session *session);
+  void RestoreGame(Session *session, const std::string &hex);
+  void MovePlayersPiece(Session *session, const std::string &args);
+  void SendStatistics(Session *session);
+  void Watch(Session *session, const std::string &args);
+  void Unwatch(Session *session);
+  // Updates the feed of a game after every ply, even without spectators,
+  // so that one who joins later syncs with the current board. Then sends
+  // its messages to all spectators.
+  void Broadcast(Session *session);
+  // Sends "text" to all spectators of a game and lets them go.
+  void ReleaseSpectators(Session *session, const std::string &text);
+  // Called on a worker after the ai moved.
+  void NotifyAisTurn(Session *session);
+  // Called on the loop after the ai moved.
+  void FinishAisTurn(Session *session);
+  // Runs the game till a character waits or the game ends.
+  void ResumeGame(Session *session);
+  void SaveReplay(Session *session);
+  void EndGame(Session *session);
+  // Lets spectators go and forgets the id of the game.
+  void UnregisterGame(Session *session);
+  void Send(Session *session, const std::string &text);
+  void UpdateEvents(Session *session);
+  void Close(Session *session);
+
+  int epoll_fd_;
+  int listen_fd_;
+  // Wakes up the loop when the ai moved or the server is stopped.
+  int event_fd_;
+  std::atomic<bool> is_stopped_;
+  // Seeds of games.
+  Random random_;
+  // Indexed by file descriptors.
+  std::vector<Session *> sessions_;
+  int num_sessions_;
+  // Sessions playing games, indexed by ids of the games.
+  std::unordered_map<int, Session *> games_;
+  int num_games_;
+  std::string replay_directory_;
+  std::mutex finished_mutex_;
+  std::vector<Session *> finished_sessions_;
+  // Destroyed first to finish all turns of the ai.
+  AiScheduler *scheduler_;
+};
+
+#endif  // GUNJIN_SHOGI_SERVER_H_
\ No newline at end of file
@@ -0,0 +1,62 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016 Hirotaka Nagashima. All rights reserved.
+//-----------------------------------------------------------------------------
+// The server process. The protocol is described in "server.h".
+// Usage: gunjin-server [<port> | <unix socket path>] [<number of workers>]
+//                      [<replay directory>]
+//-----------------------------------------------------------------------------
+
+#include <sys/resource.h>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include "../server.h"
+
+namespace {
+
+const int kDefaultPort = 7650;
+
+Server *server = nullptr;
+
+void HandleSignal(int /*signal*/) {
+  if (server)
+    server->Stop();
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  // Allow as many sessions as possible.
+  rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+  }
+
+  // Parse arguments.
+  std::string address = (1 < argc) ? argv[1] : std::to_string(kDefaultPort);
+  int num_workers = (2 < argc) ? atoi(argv[2]) :
+      static_cast<int>(std::thread::hardware_concurrency());
+  if (num_workers <= 0)
+    num_workers = 1;
+
+  // Listen.
+  Server local_server(num_workers);
+  if (3 < argc)
+    local_server.set_replay_directory(argv[3]);
+  bool is_port = (address.find_first_not_of("0123456789") == std::string::npos);
+  bool is_listening = is_port ? local_server.ListenTcp(atoi(address.c_str())) :
+      local_server.ListenUnix(address);
+  if (!is_listening)
+    return -1;
+
+  // Serve till a signal.
+  server = &local_server;
+  signal(SIGINT, HandleSignal);
+  signal(SIGTERM, HandleSignal);
+  local_server.Run();
+  server = nullptr;
+  return 0;
+}
\ No newline at end of file
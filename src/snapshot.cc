@@ -0,0 +1,235 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016 Hirotaka Nagashima. All rights reserved.
+//-----------------------------------------------------------------------------
+// Information on this class is described in "snapshot.h".
+//-----------------------------------------------------------------------------
+
+#include "snapshot.h"
+#include <cstring>
+#include "board.h"
+#include "character.h"
+#include "match.h"
+
+namespace {
+
+const int kSizeHeader = 8;
+const int kSizePiece = 3;
+const int kSizeBoard = Board::kHeight * Board::kWidth * kSizePiece + 18;
+const int kSizeBelief = 3;
+const int kSizeLog =
+  4 + kSizePiece * 2 + 2 + 8 + 1 + kSizeBelief * Board::kMaxNumBeliefs;
+const int kSizeMatch = 10;
+
+class Writer {
+public:
+  explicit Writer(char *bytes) : bytes_(bytes) {}
+
+  template <typename T> void Put(T value) {
+    memcpy(bytes_, &value, sizeof(value));
+    bytes_ += sizeof(value);
+  }
+  void Put(const Board::Piece &piece) {
+    Put(static_cast<int8_t>(piece.piece));
+    Put(static_cast<int8_t>(piece.supposition));
+    Put(static_cast<int8_t>(piece.characters_id));
+  }
+
+private:
+  char *bytes_;
+};
+
+class Reader {
+public:
+  explicit Reader(const char *bytes) : bytes_(bytes) {}
+
+  template <typename T> T Get() {
+    T value;
+    memcpy(&value, bytes_, sizeof(value));
+    bytes_ += sizeof(value);
+    return value;
+  }
+  Board::Piece GetPiece() {
+    Board::Piece piece;
+    piece.piece = static_cast<Board::Piece::KindPiece>(Get<int8_t>());
+    piece.supposition = static_cast<Board::Piece::KindPiece>(Get<int8_t>());
+    piece.characters_id = Get<int8_t>();
+    return piece;
+  }
+
+private:
+  const char *bytes_;
+};
+
+}  // namespace
+
+void Snapshot::Save(const Match &match, std::string *bytes) {
+  const Board &board = *match.board_;
+  bytes->resize(kSizeHeader + kSizeBoard + kSizeLog * board.num_logs_ +
+                kSizeMatch);
+  Writer writer(&(*bytes)[0]);
+
+  // Header.
+  writer.Put(kMagic);
+  writer.Put(kVersion);
+  writer.Put(static_cast<uint16_t>(board.num_logs_));
+
+  // Board.
+  for (int y = 0; y < Board::kHeight; ++y) {
+    for (int x = 0; x < Board::kWidth; ++x)
+      writer.Put(board.board_[y][x]);
+  }
+  writer.Put(board.hash_);
+  writer.Put(board.random_.state());
+  for (int i = 0; i < Board::kNumPlayers; ++i)
+    writer.Put(static_cast<int8_t>(board.num_pieces_[i]));
+
+  // Logs.
+  for (int i = 0; i < board.num_logs_; ++i) {
+    const Board::Log &log = board.logs_[i];
+    writer.Put(static_cast<int8_t>(log.move.src.y));
+    writer.Put(static_cast<int8_t>(log.move.src.x));
+    writer.Put(static_cast<int8_t>(log.move.dest.y));
+    writer.Put(static_cast<int8_t>(log.move.dest.x));
+    writer.Put(log.src_piece);
+    writer.Put(log.dest_piece);
+    writer.Put(static_cast<int8_t>(log.num_pieces[0]));
+    writer.Put(static_cast<int8_t>(log.num_pieces[1]));
+    writer.Put(log.hash);
+    writer.Put(static_cast<int8_t>(log.num_beliefs));
+    for (int j = 0; j < Board::kMaxNumBeliefs; ++j) {
+      Board::Belief belief = {};
+      if (j < log.num_beliefs)
+        belief = log.beliefs[j];
+      writer.Put(static_cast<int8_t>(belief.point.y));
+      writer.Put(static_cast<int8_t>(belief.point.x));
+      writer.Put(static_cast<int8_t>(belief.prev_supposition));
+    }
+  }
+
+  // Match.
+  writer.Put(static_cast<int8_t>(match.phase_));
+  writer.Put(static_cast<int8_t>(match.turn_));
+  writer.Put(static_cast<int8_t>((match.turn_is_started_ ? 1 : 0) |
+                                 (match.turn_is_ended_ ? 2 : 0) |
+                                 (match.game_was_drawn_ ? 4 : 0)));
+  writer.Put(static_cast<int8_t>(match.winners_id_));
+  writer.Put(static_cast<int16_t>(match.max_num_plies_));
+  for (int i = 0; i < Board::kNumPlayers; ++i)
+    writer.Put(static_cast<int16_t>(match.characters_[i]->score()));
+}
+
+bool Snapshot::Restore(const std::string &bytes, Match *match) {
+  Board &board = *match->board_;
+  if (static_cast<int>(bytes.size()) < kSizeHeader)
+    return false;
+
+  // Header.
+  Reader reader(bytes.data());
+  int num_logs = 0;
+  if (reader.Get<uint32_t>() != kMagic || reader.Get<uint16_t>() != kVersion)
+    return false;
+  num_logs = reader.Get<uint16_t>();
+  if (Board::kMaxNumLogs <= num_logs ||
+      static_cast<int>(bytes.size()) !=
+      kSizeHeader + kSizeBoard + kSizeLog * num_logs + kSizeMatch) {
+    return false;
+  }
+
+  // Everything is checked before the match is written, so that broken
+  // bytes leave it as it was. Logs are read twice instead of being copied,
+  // because there are many of them.
+  auto read_log = [](Reader *reader, Board::Log *log) {
+    log->move.src.y = reader->Get<int8_t>();
+    log->move.src.x = reader->Get<int8_t>();
+    log->move.dest.y = reader->Get<int8_t>();
+    log->move.dest.x = reader->Get<int8_t>();
+    log->src_piece = reader->GetPiece();
+    log->dest_piece = reader->GetPiece();
+    log->num_pieces[0] = reader->Get<int8_t>();
+    log->num_pieces[1] = reader->Get<int8_t>();
+    log->hash = reader->Get<uint64_t>();
+    log->num_beliefs = reader->Get<int8_t>();
+    bool beliefs_are_valid = (0 <= log->num_beliefs &&
+                              log->num_beliefs <= Board::kMaxNumBeliefs);
+    for (int i = 0; i < Board::kMaxNumBeliefs; ++i) {
+      Board::Belief &belief = log->beliefs[i];
+      belief.point.y = reader->Get<int8_t>();
+      belief.point.x = reader->Get<int8_t>();
+      belief.prev_supposition =
+          static_cast<Board::Piece::KindPiece>(reader->Get<int8_t>());
+      // The previous supposition is valid as a supposition of any piece.
+      Board::Piece prev_belief = log->src_piece;
+      prev_belief.supposition = belief.prev_supposition;
+      if (i < log->num_beliefs) {
+        beliefs_are_valid &= (Board::IsInside(belief.point) &&
+                              prev_belief.IsValid());
+      }
+    }
+    bool piece_counts_are_valid = true;
+    for (int i = 0; i < Board::kNumPlayers; ++i) {
+      piece_counts_are_valid &= (0 <= log->num_pieces[i] &&
+                                 log->num_pieces[i] <= Board::kNumPieces);
+    }
+    return (Board::IsInside(log->move.src) &&
+            Board::IsInside(log->move.dest) &&
+            log->src_piece.IsValid() && log->dest_piece.IsValid() &&
+            piece_counts_are_valid && beliefs_are_valid);
+  };
+
+  // Board.
+  Board::Squares squares;
+  for (int y = 0; y < Board::kHeight; ++y) {
+    for (int x = 0; x < Board::kWidth; ++x)
+      squares[y][x] = reader.GetPiece();
+  }
+  if (!Board::IsLoadable(squares))
+    return false;
+  // The hash and the numbers of pieces are derived from squares.
+  reader.Get<uint64_t>();
+  uint64_t random_state = reader.Get<uint64_t>();
+  for (int i = 0; i < Board::kNumPlayers; ++i)
+    reader.Get<int8_t>();
+
+  // Logs.
+  Reader logs_reader = reader;
+  for (int i = 0; i < num_logs; ++i) {
+    Board::Log log;
+    if (!read_log(&reader, &log))
+      return false;
+  }
+
+  // Match.
+  int phase = reader.Get<int8_t>();
+  int turn = reader.Get<int8_t>();
+  int flags = reader.Get<int8_t>();
+  int winners_id = reader.Get<int8_t>();
+  int max_num_plies = reader.Get<int16_t>();
+  if (phase < Match::kReplacing || Match::kEnded < phase ||
+      turn < 0 || Board::kNumPlayers <= turn ||
+      winners_id < 0 || Board::kNumPlayers <= winners_id ||
+      max_num_plies <= 0) {
+    return false;
+  }
+  // A limit of an older build may be over the capacity of the board.
+  if (Board::kDefaultMaxNumPlies < max_num_plies)
+    max_num_plies = Board::kDefaultMaxNumPlies;
+
+  // Write the match.
+  memcpy(board.board_, squares, sizeof(squares));
+  board.random_.set_state(random_state);
+  board.num_logs_ = num_logs;
+  for (int i = 0; i < num_logs; ++i)
+    read_log(&logs_reader, &board.logs_[i]);
+  board.Rehash();
+  match->phase_ = static_cast<Match::Phase>(phase);
+  match->turn_ = turn;
+  match->turn_is_started_ = ((flags & 1) != 0);
+  match->turn_is_ended_ = ((flags & 2) != 0);
+  match->game_was_drawn_ = ((flags & 4) != 0);
+  match->winners_id_ = winners_id;
+  match->max_num_plies_ = max_num_plies;
+  for (int i = 0; i < Board::kNumPlayers; ++i)
+    match->characters_[i]->set_score(reader.Get<int16_t>());
+
+  return true;
+}
\ No newline at end of file
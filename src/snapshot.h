@@ -0,0 +1,41 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016 Hirotaka Nagashima. All rights reserved.
+//-----------------------------------------------------------------------------
+// This class saves a whole game into bytes and restores it, to move a game
+// to another process or to resume it after a crash.
+//
+// Bytes are laid out in the order below with fixed sizes, so they are
+// restored by copying without parsing. Integers are in the native order.
+//   header   magic(4) version(2) num_logs(2)
+//   board    squares(48 * 3) hash(8) random(8) num_pieces(2)
+//   logs     num_logs * 27
+//   match    phase(1) turn(1) flags(1) winners_id(1) max_num_plies(2)
+//            scores(2 * 2)
+// A piece is kind(1) supposition(1) characters_id(1). A log ends with
+// num_beliefs(1) and two beliefs of y(1) x(1) prev_supposition(1), of which
+// unused ones are zero.
+//-----------------------------------------------------------------------------
+
+#ifndef GUNJIN_SHOGI_SNAPSHOT_H_
+#define GUNJIN_SHOGI_SNAPSHOT_H_
+
+#include <cstdint>
+#include <string>
+
+class Board;
+class Match;
+class Snapshot {
+public:
+  static const uint32_t kMagic = 0x53534a47;  // "GJSS"
+  static const uint16_t kVersion = 2;
+
+  // Saves a game between turns. Suppositions of the ai are on the board.
+  static void Save(const Match &match, std::string *bytes);
+  // Restores a game into a match made with the same kinds of characters.
+  // Returns false and leaves the match as it was if any field is out of
+  // range. The hash, the numbers of pieces and the attack maps are
+  // rebuilt from squares instead of being trusted.
+  static bool Restore(const std::string &bytes, Match *match);
+};
+
+#endif  // GUNJIN_SHOGI_SNAPSHOT_H_
\ No newline at end of file
@@ -0,0 +1,293 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016 Hirotaka Nagashima. All rights reserved.
+//-----------------------------------------------------------------------------
+// Tunes the weights of the evaluation of the ai by self-play.
+// Usage: gunjin-tune [-j <number of workers>] [-g <number of games>]
+//                    [-e <number of epochs>] <position file> <weight file>
+// Positions of new games are appended to the position file, and weights
+// fitted to the results of all positions in it are written in the format
+// of "weights.txt". Positions are read in batches, so their number is
+// limited only by the disk. The position file starts with a magic number
+// and the number of features, so that a file of other features is
+// rejected instead of being read as garbage.
+//-----------------------------------------------------------------------------
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../ai.h"
+#include "../board.h"
+#include "../match.h"
+
+namespace {
+
+struct Header {
+  uint32_t magic;
+  int32_t num_features;
+};
+const uint32_t kMagic = 0x50544a47;  // "GJTP"
+
+// A position seen from the ai who has just moved.
+struct Position {
+  int16_t features[Ai::kNumFeatures];
+  // 0 for a loss, 1 for a draw and 2 for a win.
+  int16_t result;
+};
+
+const int kDefaultNumGames = 1000;
+const int kDefaultNumEpochs = 20;
+const int kBatchSize = 4096;
+const double kLearningRate = 0.1;
+// Candidates of the evaluation value for which the winning rate is 73%.
+const double kScales[] = {25, 50, 100, 200, 400, 800, 1600, 3200, 6400};
+const int kNumScales = sizeof(kScales) / sizeof(kScales[0]);
+
+std::mutex file_mutex;
+
+double Sigmoid(double x) { return 1.0 / (1.0 + exp(-x)); }
+
+double LogLoss(double probability, double result) {
+  const double kEpsilon = 1e-12;
+  return -(result * log(probability + kEpsilon) +
+           (1.0 - result) * log(1.0 - probability + kEpsilon));
+}
+
+// Plays a game and writes its positions at once.
+void PlayGame(uint64_t seed, FILE *file) {
+  Board board;
+  board.random().Seed(seed);
+  board.Initialize();
+  Ai first(&board, 0, "first");
+  Ai second(&board, 1, "second");
+  Ai *ais[Board::kNumPlayers] = {&first, &second};
+  Match match(&board, &first, &second);
+
+  // Keep ids of the ais in results till the game ends.
+  std::vector<Position> positions;
+  Match::Event event;
+  while ((event = match.Resume()) != Match::kGameEnded) {
+    if (event != Match::kTurnEnded || match.phase() != Match::kMoving)
+      continue;
+
+    int features[Ai::kNumFeatures];
+    board.set_supposer_id(match.turn());
+    ais[match.turn()]->ExtractFeatures(features);
+    Position position;
+    for (int i = 0; i < Ai::kNumFeatures; ++i)
+      position.features[i] = static_cast<int16_t>(features[i]);
+    position.result = static_cast<int16_t>(match.turn());
+    positions.push_back(position);
+  }
+  for (int i = 0; i < static_cast<int>(positions.size()); ++i) {
+    int id = positions[i].result;
+    positions[i].result = match.game_was_drawn() ? 1 :
+        (match.winners_id() == id) ? 2 : 0;
+  }
+
+  // A game may end before any move.
+  if (positions.empty())
+    return;
+  std::lock_guard<std::mutex> lock(file_mutex);
+  fwrite(&positions[0], sizeof(Position), positions.size(), file);
+}
+
+// Returns false if "file" doesn't start with the header of the features.
+bool ReadHeader(FILE *file) {
+  Header header;
+  return (fread(&header, sizeof(header), 1, file) == 1 &&
+          header.magic == kMagic && header.num_features == Ai::kNumFeatures);
+}
+
+// Reads positions in batches and calls "process" for each batch.
+// Returns false if the file is not of positions of the features.
+template <typename Function>
+bool ReadPositions(const char *path, Function process) {
+  FILE *file = fopen(path, "rb");
+  if (!file)
+    return false;
+  if (!ReadHeader(file)) {
+    fclose(file);
+    return false;
+  }
+  std::vector<Position> batch(kBatchSize);
+  size_t num_positions;
+  while ((num_positions = fread(&batch[0], sizeof(Position), kBatchSize,
+                                file)) > 0) {
+    process(batch, static_cast<int>(num_positions));
+  }
+  fclose(file);
+  return true;
+}
+
+double Evaluate(const std::vector<double> &weights,
+                const Position &position) {
+  double evaluation_value = 0.0;
+  for (int i = 0; i < Ai::kNumFeatures; ++i)
+    evaluation_value += weights[i] * position.features[i];
+  return evaluation_value;
+}
+
+bool WriteWeights(const char *path, const std::vector<double> &weights) {
+  FILE *file = fopen(path, "w");
+  if (!file)
+    return false;
+  fprintf(file, "%d\n\n", Ai::kNumFeatures);
+  for (int i = 0; i < Ai::kNumFeatures; ++i) {
+    int max_weight = (i < Ai::kFeatureMaterial) ? Ai::kMaxStrengthWeight :
+        Ai::kMaxMaterialWeight;
+    int weight = static_cast<int>(lround(weights[i]));
+    weight = (weight < -max_weight) ? -max_weight :
+        (max_weight < weight) ? max_weight : weight;
+    bool is_last_kind = (i == Ai::kFeatureUnknown - 1);
+    fprintf(file, "%d%s", weight,
+            (is_last_kind || Ai::kFeatureUnknown <= i) ? "\n" : " ");
+  }
+  return fclose(file) == 0;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  // Parse arguments.
+  int num_workers = static_cast<int>(std::thread::hardware_concurrency());
+  int num_games = kDefaultNumGames;
+  int num_epochs = kDefaultNumEpochs;
+  int arg = 1;
+  for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2) {
+    if (strcmp(argv[arg], "-j") == 0)
+      num_workers = atoi(argv[arg + 1]);
+    else if (strcmp(argv[arg], "-g") == 0)
+      num_games = atoi(argv[arg + 1]);
+    else if (strcmp(argv[arg], "-e") == 0)
+      num_epochs = atoi(argv[arg + 1]);
+  }
+  if (argc - arg != 2) {
+    fprintf(stderr, "Usage: %s [-j <number of workers>] "
+            "[-g <number of games>] [-e <number of epochs>] "
+            "<position file> <weight file>\n", argv[0]);
+    return -1;
+  }
+  if (num_workers <= 0)
+    num_workers = 1;
+  const char *kPositionPath = argv[arg];
+  const char *kWeightPath = argv[arg + 1];
+
+  // Play games on each worker.
+  if (0 < num_games) {
+    FILE *file = fopen(kPositionPath, "a+b");
+    if (!file) {
+      fprintf(stderr, "ERROR: %s can't be written.\n", kPositionPath);
+      return -1;
+    }
+    // A new file gets the header, and an old one must have it.
+    bool header_is_valid;
+    fseek(file, 0, SEEK_END);
+    if (ftell(file) == 0) {
+      Header header = {kMagic, Ai::kNumFeatures};
+      header_is_valid = (fwrite(&header, sizeof(header), 1, file) == 1);
+    } else {
+      rewind(file);
+      header_is_valid = ReadHeader(file);
+      fseek(file, 0, SEEK_END);
+    }
+    if (!header_is_valid) {
+      fprintf(stderr, "ERROR: %s is not a position file of %d features.\n",
+              kPositionPath, Ai::kNumFeatures);
+      fclose(file);
+      return -1;
+    }
+    const uint64_t kSeed = static_cast<uint64_t>(time(nullptr)) << 20;
+    std::atomic<int> next_id(0);
+    std::vector<std::thread> workers;
+    for (int i = 0; i < num_workers; ++i) {
+      workers.push_back(std::thread([&]() {
+        int id;
+        while ((id = next_id++) < num_games)
+          PlayGame(kSeed + id, file);
+      }));
+    }
+    for (int i = 0; i < num_workers; ++i)
+      workers[i].join();
+    fclose(file);
+    printf("%d games are played.\n", num_games);
+  }
+
+  // Choose the scale with the current weights, and precondition the
+  // gradient with the magnitude of each feature.
+  const std::vector<int> &kDefaultWeights = Ai::default_weights();
+  std::vector<double> weights(kDefaultWeights.begin(), kDefaultWeights.end());
+  std::vector<double> losses(kNumScales, 0.0);
+  std::vector<double> squares(Ai::kNumFeatures, 0.0);
+  int64_t num_positions = 0;
+  bool is_read = ReadPositions(kPositionPath,
+      [&](const std::vector<Position> &batch, int n) {
+    for (int i = 0; i < n; ++i) {
+      double evaluation_value = Evaluate(weights, batch[i]);
+      for (int j = 0; j < kNumScales; ++j) {
+        losses[j] += LogLoss(Sigmoid(evaluation_value / kScales[j]),
+                             batch[i].result / 2.0);
+      }
+      for (int j = 0; j < Ai::kNumFeatures; ++j)
+        squares[j] += batch[i].features[j] * batch[i].features[j];
+    }
+    num_positions += n;
+  });
+  if (!is_read) {
+    fprintf(stderr, "ERROR: %s is not a position file of %d features.\n",
+            kPositionPath, Ai::kNumFeatures);
+    return -1;
+  }
+  if (num_positions == 0) {
+    fprintf(stderr, "ERROR: %s has no positions.\n", kPositionPath);
+    return -1;
+  }
+  int scale_id = 0;
+  for (int i = 1; i < kNumScales; ++i) {
+    if (losses[i] < losses[scale_id])
+      scale_id = i;
+  }
+  const double kScale = kScales[scale_id];
+  printf("%lld positions, scale %.0f, loss %f\n",
+         static_cast<long long>(num_positions), kScale,
+         losses[scale_id] / num_positions);
+
+  // Descend the gradient of the log loss in each batch.
+  for (int epoch = 1; epoch <= num_epochs; ++epoch) {
+    double loss = 0.0;
+    ReadPositions(kPositionPath,
+        [&](const std::vector<Position> &batch, int n) {
+      std::vector<double> gradient(Ai::kNumFeatures, 0.0);
+      for (int i = 0; i < n; ++i) {
+        double probability = Sigmoid(Evaluate(weights, batch[i]) / kScale);
+        double result = batch[i].result / 2.0;
+        loss += LogLoss(probability, result);
+        for (int j = 0; j < Ai::kNumFeatures; ++j)
+          gradient[j] += (probability - result) * batch[i].features[j];
+      }
+
+      // The curvature is at most "features ^ 2 / (4 * scale ^ 2)".
+      for (int j = 0; j < Ai::kNumFeatures; ++j) {
+        if (squares[j] <= 0.0)
+          continue;
+        double curvature = squares[j] / num_positions /
+            (4.0 * kScale * kScale);
+        weights[j] -= kLearningRate * gradient[j] / (n * kScale) / curvature;
+      }
+    });
+    printf("epoch %d, loss %f\n", epoch, loss / num_positions);
+  }
+
+  if (!WriteWeights(kWeightPath, weights)) {
+    fprintf(stderr, "ERROR: %s can't be written.\n", kWeightPath);
+    return -1;
+  }
+  return 0;
+}
\ No newline at end of file
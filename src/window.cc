@@ -6,9 +6,13 @@
 
 #include "window.h"
 #include <iostream>
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include "point.h"
 
+const char Window::kGlyphs[kNumGlyphs + 1] = "0123456789+- ";
+
 void Window::Initialize() {
   if (SDL_Init(SDL_INIT_VIDEO) < 0) {
     std::cerr << "ERROR: " << SDL_GetError() << std::endl;
@@ -27,7 +31,23 @@ void Window::Initialize() {
   video_surface_ = SDL_GetWindowSurface(window_);
 }
 
+void Window::InitializeOffscreen() {
+  is_offscreen_ = true;
+  video_surface_ = SDL_CreateRGBSurfaceWithFormat(0, kWidth, kHeight, 32,
+                                                  SDL_PIXELFORMAT_RGB888);
+  if (!video_surface_) {
+    std::cerr << "ERROR: " << SDL_GetError() << std::endl;
+    exit(-1);
+  }
+}
+
 void Window::Terminate() {
+  ReleaseTexts();
+  if (is_offscreen_) {
+    SDL_FreeSurface(video_surface_);
+    video_surface_ = nullptr;
+    return;
+  }
   SDL_DestroyWindow(window_);
   window_ = nullptr;
   video_surface_ = nullptr;
@@ -35,12 +55,29 @@ void Window::Terminate() {
   SDL_Quit();
 }
 
-void Window::UpdateSurface() const {
-  SDL_UpdateWindowSurface(window_);
+bool Window::SavePng(const char *file_name) const {
+  return (IMG_SavePNG(video_surface_, file_name) == 0);
+}
+
+void Window::UpdateSurface() {
+  if (is_offscreen_) {
+    dirty_rects_.clear();
+    is_all_dirty_ = false;
+    return;
+  }
+  int num_dirty_rects = static_cast<int>(dirty_rects_.size());
+  if (is_all_dirty_ || kMaxNumDirtyRects < num_dirty_rects) {
+    SDL_UpdateWindowSurface(window_);
+  } else if (0 < num_dirty_rects) {
+    SDL_UpdateWindowSurfaceRects(window_, &dirty_rects_[0], num_dirty_rects);
+  }
+  dirty_rects_.clear();
+  is_all_dirty_ = false;
 }
 
 void Window::ClearScreen() {
   SDL_FillRect(video_surface_, nullptr, 0);
+  is_all_dirty_ = true;
 }
 
 void Window::DrawSingleImage(SDL_Surface *image, int dest_x, int dest_y) {
@@ -51,6 +88,7 @@ void Window::DrawSingleImage(SDL_Surface *image, int dest_x, int dest_y) {
   dest.x = dest_x;
   dest.y = dest_y;
   SDL_BlitSurface(image, &src, video_surface_, &dest);
+  AddDirtyRect(dest);
 }
 
 void Window::DrawImage(SDL_Surface *image, int dest_x, int dest_y,
@@ -63,11 +101,12 @@ void Window::DrawImage(SDL_Surface *image, int dest_x, int dest_y,
   dest.x = dest_x;
   dest.y = dest_y;
   SDL_BlitSurface(image, &src, video_surface_, &dest);
+  AddDirtyRect(dest);
 }
 
 void Window::DrawString(const char *text, int dest_x, int dest_y,
                         TTF_Font *font, const SDL_Color &color) {
-  SDL_Surface *temp_text = TTF_RenderUTF8_Blended(font, text, color);
+  SDL_Surface *temp_text = RenderText(text, font, color);
   SDL_Rect src, dest;
   src.x = 0;
   src.y = 0;
@@ -76,12 +115,12 @@ void Window::DrawString(const char *text, int dest_x, int dest_y,
   dest.x = dest_x;
   dest.y = dest_y;
   SDL_BlitSurface(temp_text, &src, video_surface_, &dest);
-  SDL_FreeSurface(temp_text);
+  AddDirtyRect(dest);
 }
 
 void Window::DrawStringCenter(const char *text, int dest_y,
                               TTF_Font *font, const SDL_Color &color) {
-  SDL_Surface *temp_text = TTF_RenderUTF8_Blended(font, text, color);
+  SDL_Surface *temp_text = RenderText(text, font, color);
   SDL_Rect src, dest;
   src.x = 0;
   src.y = 0;
@@ -90,14 +129,44 @@ void Window::DrawStringCenter(const char *text, int dest_y,
   dest.x = (kWidth - temp_text->w) / 2;
   dest.y = dest_y;
   SDL_BlitSurface(temp_text, &src, video_surface_, &dest);
-  SDL_FreeSurface(temp_text);
+  AddDirtyRect(dest);
 }
 
-void Window::Sleep(int duration) const {
-  // Divide duration by 10 for lighter processing.
-  for (int i = 0; i < duration / 10; ++i) {
-    SDL_Delay(10);
-    CheckClose();
+void Window::DrawGlyphs(const char *text, int dest_x, int dest_y,
+                        TTF_Font *font, const SDL_Color &color) {
+  // Draw the whole text if it has a character out of the atlas.
+  if (strspn(text, kGlyphs) != strlen(text)) {
+    DrawString(text, dest_x, dest_y, font, color);
+    return;
+  }
+
+  const GlyphAtlas &atlas = GetGlyphAtlas(font, color);
+  for (const char *c = text; *c; ++c) {
+    SDL_Rect src = atlas.glyphs[strchr(kGlyphs, *c) - kGlyphs];
+    SDL_Rect dest;
+    dest.x = dest_x;
+    dest.y = dest_y;
+    dest_x += src.w;
+    SDL_BlitSurface(atlas.surface, &src, video_surface_, &dest);
+    AddDirtyRect(dest);
+  }
+}
+
+void Window::Sleep(int duration) {
+  UpdateSurface();
+
+  // Wake up only on events.
+  const Clock::time_point kEnd =
+      Clock::now() + std::chrono::milliseconds(duration);
+  while (true) {
+    int remaining = static_cast<int>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            kEnd - Clock::now()).count());
+    if (remaining <= 0)
+      return;
+    SDL_Event event;
+    if (SDL_WaitEventTimeout(&event, remaining) && event.type == SDL_QUIT)
+      exit(0);
   }
 }
 
@@ -110,6 +179,8 @@ void Window::CheckClose() const {
 }
 
 Point Window::WaitClick(bool distinguish_mouse_down) {
+  UpdateSurface();
+
   // Get the current state of the mouse button.
   while (true) {
     SDL_Event event;
@@ -127,15 +198,192 @@ Point Window::WaitClick(bool distinguish_mouse_down) {
   }
 }
 
-void Window::WaitEnterKey() const {
+bool Window::PollClick(Point *point) {
+  RunAnimations();
+  UpdateSurface();
+  SDL_Event event;
+  while (SDL_PollEvent(&event)) {
+    if (event.type == SDL_QUIT)
+      exit(0);
+    if (event.type == SDL_MOUSEBUTTONUP) {
+      // Show the end of animations before the click is handled.
+      FinishAnimations();
+      point->y = event.button.y;
+      point->x = event.button.x;
+      return true;
+    }
+  }
+  return false;
+}
+
+void Window::WaitEvent(bool keeps_clicks) {
+  RunAnimations();
+  UpdateSurface();
+
+  // Wait till the next step is due at most.
+  if (is_animating()) {
+    int remaining = static_cast<int>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            animations_.begin()->first - Clock::now()).count());
+    SDL_WaitEventTimeout(nullptr, std::max(1, remaining));
+  } else {
+    SDL_WaitEvent(nullptr);
+  }
+
+  // Take events till a click.
+  SDL_Event event;
+  while (SDL_PeepEvents(&event, 1, SDL_PEEKEVENT,
+                        SDL_FIRSTEVENT, SDL_LASTEVENT) > 0) {
+    if (event.type == SDL_MOUSEBUTTONUP && keeps_clicks)
+      break;
+    SDL_PollEvent(&event);
+    if (event.type == SDL_QUIT)
+      exit(0);
+  }
+  RunAnimations();
+  UpdateSurface();
+}
+
+void Window::Wake() const {
+  SDL_Event event = {};
+  event.type = SDL_USEREVENT;
+  SDL_PushEvent(&event);
+}
+
+void Window::Schedule(int delay, const std::function<void()> &step) {
+  animations_.insert(std::make_pair(
+      Clock::now() + std::chrono::milliseconds(delay), step));
+}
+
+void Window::FinishAnimations() {
+  // A step may schedule another one.
+  while (is_animating()) {
+    std::function<void()> step = animations_.begin()->second;
+    animations_.erase(animations_.begin());
+    step();
+  }
+}
+
+bool Window::HasClick() const {
+  SDL_Event event;
+  return (SDL_PeepEvents(&event, 1, SDL_PEEKEVENT,
+                         SDL_MOUSEBUTTONUP, SDL_MOUSEBUTTONUP) > 0);
+}
+
+void Window::WaitEnterKey() {
+  UpdateSurface();
   while (true) {
     SDL_Event event;
-    while (SDL_PollEvent(&event)) {
-      if (event.type == SDL_QUIT)
-        exit(0);
-      if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_RETURN)
-        return;
+    SDL_WaitEvent(&event);
+    if (event.type == SDL_QUIT)
+      exit(0);
+    if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_RETURN)
+      return;
+  }
+}
+
+void Window::RunAnimations() {
+  const Clock::time_point kNow = Clock::now();
+  while (is_animating() && animations_.begin()->first <= kNow) {
+    std::function<void()> step = animations_.begin()->second;
+    animations_.erase(animations_.begin());
+    step();
+  }
+}
+
+void Window::AddDirtyRect(const SDL_Rect &rect) {
+  // Skip a region clipped out.
+  if (rect.w <= 0 || rect.h <= 0 || is_all_dirty_)
+    return;
+  dirty_rects_.push_back(rect);
+}
+
+SDL_Surface *Window::RenderText(const char *text, TTF_Font *font,
+                                const SDL_Color &color) {
+  // Find the text rendered with the same font and color.
+  std::string key(reinterpret_cast<const char *>(&font), sizeof(font));
+  key.append(reinterpret_cast<const char *>(&color), sizeof(color));
+  key += text;
+  std::unordered_map<std::string, std::list<CachedText>::iterator>::iterator
+      found = cached_text_table_.find(key);
+  if (found != cached_text_table_.end()) {
+    cached_texts_.splice(cached_texts_.begin(), cached_texts_, found->second);
+    return found->second->surface;
+  }
+
+  // Render the text and release the least recently used one.
+  SDL_Surface *surface = TTF_RenderUTF8_Blended(font, text, color);
+  if (!surface) {
+    std::cerr << "ERROR: " << TTF_GetError() << std::endl;
+    exit(-1);
+  }
+  if (kMaxNumCachedTexts <= static_cast<int>(cached_texts_.size())) {
+    CachedText &oldest = cached_texts_.back();
+    SDL_FreeSurface(oldest.surface);
+    cached_text_table_.erase(oldest.key);
+    cached_texts_.pop_back();
+  }
+  CachedText cached_text = {key, surface};
+  cached_texts_.push_front(cached_text);
+  cached_text_table_[key] = cached_texts_.begin();
+  return surface;
+}
+
+const Window::GlyphAtlas &Window::GetGlyphAtlas(TTF_Font *font,
+                                                const SDL_Color &color) {
+  for (int i = 0; i < static_cast<int>(glyph_atlases_.size()); ++i) {
+    const GlyphAtlas &atlas = glyph_atlases_[i];
+    if (atlas.font == font && memcmp(&atlas.color, &color, sizeof(color)) == 0)
+      return atlas;
+  }
+
+  // Render each glyph, whose width is its advance.
+  GlyphAtlas atlas;
+  atlas.font = font;
+  atlas.color = color;
+  SDL_Surface *glyphs[kNumGlyphs];
+  int width = 0, height = 0;
+  for (int i = 0; i < kNumGlyphs; ++i) {
+    char glyph[] = {kGlyphs[i], '\0'};
+    glyphs[i] = TTF_RenderUTF8_Blended(font, glyph, color);
+    if (!glyphs[i]) {
+      std::cerr << "ERROR: " << TTF_GetError() << std::endl;
+      exit(-1);
     }
-    SDL_Delay(10);
+    width += glyphs[i]->w;
+    height = std::max(height, glyphs[i]->h);
+  }
+
+  // Copy glyphs with their alpha into one surface.
+  atlas.surface = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32,
+                                                 SDL_PIXELFORMAT_ARGB8888);
+  int x = 0;
+  for (int i = 0; i < kNumGlyphs; ++i) {
+    SDL_Rect &dest = atlas.glyphs[i];
+    dest.x = x;
+    dest.y = 0;
+    dest.w = glyphs[i]->w;
+    dest.h = glyphs[i]->h;
+    x += dest.w;
+    SDL_SetSurfaceBlendMode(glyphs[i], SDL_BLENDMODE_NONE);
+    SDL_Rect copied_dest = dest;
+    SDL_BlitSurface(glyphs[i], nullptr, atlas.surface, &copied_dest);
+    SDL_FreeSurface(glyphs[i]);
+  }
+  SDL_SetSurfaceBlendMode(atlas.surface, SDL_BLENDMODE_BLEND);
+
+  glyph_atlases_.push_back(atlas);
+  return glyph_atlases_.back();
+}
+
+void Window::ReleaseTexts() {
+  for (std::list<CachedText>::iterator it = cached_texts_.begin();
+       it != cached_texts_.end(); ++it) {
+    SDL_FreeSurface(it->surface);
   }
+  cached_texts_.clear();
+  cached_text_table_.clear();
+  for (int i = 0; i < static_cast<int>(glyph_atlases_.size()); ++i)
+    SDL_FreeSurface(glyph_atlases_[i].surface);
+  glyph_atlases_.clear();
 }
\ No newline at end of file
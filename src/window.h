@@ -2,13 +2,19 @@
 // Copyright (c) 2016 Hirotaka Nagashima. All rights reserved.
 //-----------------------------------------------------------------------------
 // This class is used for gui program based on sdl.
-// You shouldn't edit this file.
+// Drawn regions are presented together before waiting for input.
 //-----------------------------------------------------------------------------
 
 #ifndef SDL_WINDOW_H_
 #define SDL_WINDOW_H_
 
+#include <chrono>
+#include <functional>
+#include <list>
+#include <map>
 #include <string>
+#include <unordered_map>
+#include <vector>
 #include <SDL.h>
 #include <SDL_ttf.h>
 #include <SDL_image.h>
@@ -21,10 +27,16 @@ public:
         kHeight(height),
         kTitleName(title),
         window_(nullptr),
-        video_surface_(nullptr) {}
+        video_surface_(nullptr),
+        is_offscreen_(false),
+        is_all_dirty_(false) {}
 
   void Initialize();
+  // Draws onto a surface without a window. SDL and SDL_ttf must be
+  // initialized by the caller, which allows windows on many threads.
+  void InitializeOffscreen();
   void Terminate();
+  bool SavePng(const char *file_name) const;
   void ClearScreen();
   void DrawSingleImage(SDL_Surface *image, int dest_x, int dest_y);
   void DrawImage(SDL_Surface *image, int dest_x, int dest_y,
@@ -33,23 +45,86 @@ public:
                   const SDL_Color &color = {0xff, 0xff, 0xff});
   void DrawStringCenter(const char *text, int dest_y, TTF_Font *font,
                         const SDL_Color &color = {0xff, 0xff, 0xff});
-  void Sleep(int duration) const;
+  // Use this for text of "kGlyphs" which changes frequently like scores.
+  // Each glyph is drawn from an atlas instead of caching the whole text.
+  void DrawGlyphs(const char *text, int dest_x, int dest_y, TTF_Font *font,
+                  const SDL_Color &color = {0xff, 0xff, 0xff});
+  // Drawn regions are displayed before waiting or polling input,
+  // so a frame is made for each input event.
+  // Use "Schedule()" instead of this not to block input.
+  void Sleep(int duration);
   // Terminate the process if the window is closed.
   void CheckClose() const;
   // Returns clicked coordinate.
   Point WaitClick(bool distinguish_mouse_down);
+  // Gets clicked coordinate without blocking. A click is a mouse up.
+  // All scheduled steps run before a click is returned.
+  bool PollClick(Point *point);
+  // Waits till any event arrives or a scheduled step is due, and runs
+  // due steps. Clicks are kept for "PollClick()" if "keeps_clicks".
+  // Other events are taken.
+  void WaitEvent(bool keeps_clicks = true);
+  // Wakes up "WaitEvent()". Thread-safe.
+  void Wake() const;
+  // Runs "step" after "delay" milliseconds in "WaitEvent()" or
+  // "PollClick()", which is used for animations.
+  void Schedule(int delay, const std::function<void()> &step);
+  // Runs all scheduled steps now.
+  void FinishAnimations();
+  bool HasClick() const;
+  bool is_animating() const { return !animations_.empty(); }
   // Wait till enter key is pressed.
-  void WaitEnterKey() const;
+  void WaitEnterKey();
 
   SDL_Surface *video_surface() const { return video_surface_; }
-  void UpdateSurface() const;
+  // Displays only the regions drawn after the last update.
+  void UpdateSurface();
 
 private:
+  typedef std::chrono::steady_clock Clock;
+
+  // Over this, the whole window is updated.
+  static const int kMaxNumDirtyRects = 64;
+  // Over this, the least recently used text is released.
+  static const int kMaxNumCachedTexts = 64;
+  static const int kNumGlyphs = 13;
+  static const char kGlyphs[kNumGlyphs + 1];
+
+  struct CachedText {
+    std::string key;
+    SDL_Surface *surface;
+  };
+  // Glyphs of "kGlyphs" rendered side by side.
+  struct GlyphAtlas {
+    TTF_Font *font;
+    SDL_Color color;
+    SDL_Surface *surface;
+    SDL_Rect glyphs[kNumGlyphs];
+  };
+
+  void AddDirtyRect(const SDL_Rect &rect);
+  void RunAnimations();
+  // Returns rendered text, which is kept in the cache.
+  SDL_Surface *RenderText(const char *text, TTF_Font *font,
+                          const SDL_Color &color);
+  const GlyphAtlas &GetGlyphAtlas(TTF_Font *font, const SDL_Color &color);
+  void ReleaseTexts();
+
   const int kWidth;
   const int kHeight;
   const std::string kTitleName;
   SDL_Window *window_;
   SDL_Surface *video_surface_;
+  bool is_offscreen_;
+  std::vector<SDL_Rect> dirty_rects_;
+  bool is_all_dirty_;
+  // The most recently used text is the first.
+  std::list<CachedText> cached_texts_;
+  std::unordered_map<std::string, std::list<CachedText>::iterator>
+      cached_text_table_;
+  std::vector<GlyphAtlas> glyph_atlases_;
+  // Scheduled steps in the order they are due.
+  std::multimap<Clock::time_point, std::function<void()>> animations_;
 };
 
 #endif  // SDL_WINDOW_H_
\ No newline at end of file
@@ -0,0 +1,48 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016 Hirotaka Nagashima. All rights reserved.
+//-----------------------------------------------------------------------------
+// Information on this class is described in "worker_pool.h".
+//-----------------------------------------------------------------------------
+
+#include "worker_pool.h"
+
+WorkerPool::WorkerPool(int num_workers) : is_stopped_(false) {
+  for (int i = 0; i < num_workers; ++i)
+    workers_.push_back(std::thread(&WorkerPool::Work, this));
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    is_stopped_ = true;
+  }
+  condition_.notify_all();
+  for (int i = 0; i < static_cast<int>(workers_.size()); ++i)
+    workers_[i].join();
+}
+
+void WorkerPool::Post(const std::function<void()> &task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.push_back(task);
+  }
+  condition_.notify_one();
+}
+
+void WorkerPool::Work() {
+  while (true) {
+    // Wait for a task.
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      while (tasks_.empty() && !is_stopped_)
+        condition_.wait(lock);
+      if (tasks_.empty())
+        return;
+      task = tasks_.front();
+      tasks_.pop_front();
+    }
+
+    task();
+  }
+}
\ No newline at end of file
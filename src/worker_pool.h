@@ -0,0 +1,36 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016 Hirotaka Nagashima. All rights reserved.
+//-----------------------------------------------------------------------------
+// This class runs tasks on a fixed number of threads.
+//-----------------------------------------------------------------------------
+
+#ifndef GUNJIN_SHOGI_WORKER_POOL_H_
+#define GUNJIN_SHOGI_WORKER_POOL_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class WorkerPool {
+public:
+  explicit WorkerPool(int num_workers);
+  // Finishes all posted tasks.
+  ~WorkerPool();
+
+  // Thread-safe.
+  void Post(const std::function<void()> &task);
+
+private:
+  void Work();
+
+  std::vector<std::thread> workers_;
+  std::deque<std::function<void()> > tasks_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  bool is_stopped_;
+};
+
+#endif  // GUNJIN_SHOGI_WORKER_POOL_H_
\ No newline at end of file